@@ -9,6 +9,7 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/workqueue.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -70,7 +71,8 @@ struct channel
     struct lock lock;           /* Must acquire to access the controller. */
     bool expecting_interrupt;   /* True if an interrupt is expected, false if
                                    any interrupt would be spurious. */
-    struct semaphore completion_wait;   /* Up'd by interrupt handler. */
+    struct semaphore completion_wait;   /* Up'd by completion_work. */
+    struct work completion_work;        /* Deferred by interrupt handler. */
 
     struct ata_disk devices[2];     /* The devices on this channel. */
   };
@@ -96,6 +98,7 @@ static void select_device (const struct ata_disk *);
 static void select_device_wait (const struct ata_disk *);
 
 static void interrupt_handler (struct intr_frame *);
+static work_func complete_command;
 
 /* Initialize the disk subsystem and detect disks. */
 void
@@ -126,6 +129,7 @@ ide_init (void)
       lock_init (&c->lock);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      work_init (&c->completion_work, complete_command);
  
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -514,7 +518,7 @@ interrupt_handler (struct intr_frame *f)
         if (c->expecting_interrupt) 
           {
             inb (reg_status (c));               /* Acknowledge interrupt. */
-            sema_up (&c->completion_wait);      /* Wake up waiter. */
+            intr_defer (&c->completion_work);   /* Wake up waiter. */
           }
         else
           printf ("%s: unexpected interrupt\n", c->name);
@@ -524,4 +528,14 @@ interrupt_handler (struct intr_frame *f)
   NOT_REACHED ();
 }
 
+/* Wakes up the thread waiting for a command on the channel
+   whose completion_work is W to complete.  Deferred by
+   interrupt_handler(). */
+static void
+complete_command (struct work *w) 
+{
+  struct channel *c = work_entry (w, struct channel, completion_work);
+  sema_up (&c->completion_wait);
+}
+
 
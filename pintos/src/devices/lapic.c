@@ -0,0 +1,282 @@
+#include "devices/lapic.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/pit.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+
+/* Local Advanced Programmable Interrupt Controller (APIC).
+   Refer to [IA32-v3a] chapter 8, "Advanced Programmable
+   Interrupt Controller (APIC)", for details.
+
+   We use the local APIC's timer, as a tick source with
+   finer-grained one-shot timers than the PIT offers, and on a
+   multiprocessor as each application processor's tick, and its
+   interrupt command register, to start the application
+   processors and to send them interrupts.  External device
+   interrupts still arrive through the 8259A PICs, at the
+   bootstrap processor only.
+
+   Every CPU has its own local APIC, but all of them appear at
+   the same physical address, each CPU seeing its own. */
+
+/* APIC base address MSR. */
+#define MSR_APIC_BASE        0x1b
+#define MSR_APIC_BASE_ENABLE 0x800      /* APIC global enable. */
+#define MSR_APIC_BASE_ADDR   0xfffff000 /* Physical base address. */
+
+/* Local APIC registers, as byte offsets from its base. */
+#define LAPIC_EOI            0x0b0      /* End of interrupt. */
+#define LAPIC_SVR            0x0f0      /* Spurious interrupt vector. */
+#define LAPIC_ICR_LO         0x300      /* Interrupt command, low half. */
+#define LAPIC_ICR_HI         0x310      /* Interrupt command, high half. */
+#define LAPIC_LVT_TIMER      0x320      /* Timer local vector table. */
+#define LAPIC_TIMER_INIT     0x380      /* Timer initial count. */
+#define LAPIC_TIMER_CUR      0x390      /* Timer current count. */
+#define LAPIC_TIMER_DIV      0x3e0      /* Timer divide configuration. */
+
+/* Register bits. */
+#define LAPIC_SVR_ENABLE     0x100      /* APIC software enable. */
+#define LAPIC_LVT_MASKED     0x10000    /* Interrupt masked. */
+#define LAPIC_LVT_PERIODIC   0x20000    /* Timer repeats. */
+#define LAPIC_TIMER_DIV_16   0x3        /* Divide bus clock by 16. */
+#define LAPIC_ICR_FIXED      0x00000    /* Deliver vector as is. */
+#define LAPIC_ICR_INIT       0x00500    /* INIT: reset the target. */
+#define LAPIC_ICR_STARTUP    0x00600    /* Startup IPI. */
+#define LAPIC_ICR_PENDING    0x01000    /* Delivery not yet accepted. */
+#define LAPIC_ICR_ASSERT     0x04000    /* Level assert (vs. deassert). */
+#define LAPIC_ICR_LEVEL      0x08000    /* Level (vs. edge) triggered. */
+#define LAPIC_ICR_DEST_SHIFT 24         /* Destination APIC ID in ICR_HI. */
+
+/* Length of the timer calibration interval, in PIT cycles
+   (about 10 ms). */
+#define CALIBRATION_PIT_CYCLES (PIT_HZ / 100)
+
+/* Local APIC registers, mapped into kernel virtual memory, or a
+   null pointer if the local APIC is not in use. */
+static volatile uint32_t *lapic_regs;
+
+/* Local APIC timer counts per second. */
+static uint32_t timer_hz;
+
+static void *map_registers (uintptr_t paddr);
+static void send_ipi (uint8_t apic_id, uint32_t command);
+
+/* Returns the local APIC register at byte offset REG. */
+static inline uint32_t
+lapic_read (int reg) 
+{
+  return lapic_regs[reg / sizeof *lapic_regs];
+}
+
+/* Sets the local APIC register at byte offset REG to VALUE. */
+static inline void
+lapic_write (int reg, uint32_t value) 
+{
+  lapic_regs[reg / sizeof *lapic_regs] = value;
+}
+
+/* Enables the local APIC and measures its timer's rate against
+   the PIT.  Returns true if successful, false if the CPU has no
+   local APIC.  Must be called with interrupts off, after the
+   page allocator is initialized, and before any user process is
+   created, because the mapping for the APIC's registers is added
+   to init_page_dir.  Does nothing but return true if the local
+   APIC is already enabled. */
+bool
+lapic_init (void) 
+{
+  uint64_t base;
+  uint32_t elapsed;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (lapic_enabled ())
+    return true;
+  if (!cpu_has (CPUID_APIC | CPUID_MSR))
+    return false;
+
+  base = rdmsr (MSR_APIC_BASE);
+  if (!(base & MSR_APIC_BASE_ENABLE))
+    wrmsr (MSR_APIC_BASE, base |= MSR_APIC_BASE_ENABLE);
+  lapic_regs = map_registers (base & MSR_APIC_BASE_ADDR);
+
+  /* Software-enable the APIC, with the timer masked. */
+  lapic_write (LAPIC_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VEC);
+  lapic_write (LAPIC_TIMER_DIV, LAPIC_TIMER_DIV_16);
+  lapic_write (LAPIC_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_VEC);
+
+  /* Let the timer count down from its maximum for a known
+     interval. */
+  lapic_write (LAPIC_TIMER_INIT, UINT32_MAX);
+  pit_wait (CALIBRATION_PIT_CYCLES);
+  elapsed = UINT32_MAX - lapic_read (LAPIC_TIMER_CUR);
+  lapic_write (LAPIC_TIMER_INIT, 0);
+
+  timer_hz = (uint64_t) elapsed * PIT_HZ / CALIBRATION_PIT_CYCLES;
+  printf ("Local APIC: timer at %'"PRIu32" Hz.\n", timer_hz);
+  return true;
+}
+
+/* Enables the running application processor's local APIC, with
+   its timer stopped.  lapic_init() must already have been called
+   on the bootstrap processor. */
+void
+lapic_init_ap (void) 
+{
+  uint64_t base;
+
+  ASSERT (lapic_enabled ());
+
+  base = rdmsr (MSR_APIC_BASE);
+  if (!(base & MSR_APIC_BASE_ENABLE))
+    wrmsr (MSR_APIC_BASE, base | MSR_APIC_BASE_ENABLE);
+  lapic_write (LAPIC_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VEC);
+  lapic_write (LAPIC_TIMER_DIV, LAPIC_TIMER_DIV_16);
+  lapic_timer_stop ();
+}
+
+/* Returns true if lapic_init() has enabled the local APIC. */
+bool
+lapic_enabled (void) 
+{
+  return lapic_regs != NULL;
+}
+
+/* Acknowledges the interrupt being serviced to the local APIC. */
+void
+lapic_eoi (void) 
+{
+  ASSERT (lapic_enabled ());
+  lapic_write (LAPIC_EOI, 0);
+}
+
+/* Returns the number of local APIC timer counts per second. */
+uint32_t
+lapic_timer_hz (void) 
+{
+  return timer_hz;
+}
+
+/* Arms the local APIC timer to raise LAPIC_TIMER_VEC once,
+   COUNT timer counts from now.  Replaces any timer already
+   armed. */
+void
+lapic_timer_oneshot (uint32_t count) 
+{
+  ASSERT (lapic_enabled ());
+
+  if (count == 0)
+    count = 1;
+  lapic_write (LAPIC_LVT_TIMER, LAPIC_TIMER_VEC);
+  lapic_write (LAPIC_TIMER_INIT, count);
+}
+
+/* Arms the local APIC timer to raise interrupt VEC every COUNT
+   timer counts, until it is stopped.  Replaces any timer already
+   armed. */
+void
+lapic_timer_periodic (uint8_t vec, uint32_t count) 
+{
+  ASSERT (lapic_enabled ());
+
+  if (count == 0)
+    count = 1;
+  lapic_write (LAPIC_LVT_TIMER, LAPIC_LVT_PERIODIC | vec);
+  lapic_write (LAPIC_TIMER_INIT, count);
+}
+
+/* Disarms the local APIC timer. */
+void
+lapic_timer_stop (void) 
+{
+  ASSERT (lapic_enabled ());
+
+  lapic_write (LAPIC_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_VEC);
+  lapic_write (LAPIC_TIMER_INIT, 0);
+}
+
+/* Sends an INIT IPI to the processor with local APIC ID APIC_ID,
+   which resets it and leaves it waiting for a Startup IPI.  See
+   [MP] appendix B.4 "Application Processor Startup". */
+void
+lapic_send_init (uint8_t apic_id) 
+{
+  send_ipi (apic_id, LAPIC_ICR_INIT | LAPIC_ICR_LEVEL | LAPIC_ICR_ASSERT);
+  send_ipi (apic_id, LAPIC_ICR_INIT | LAPIC_ICR_LEVEL);
+}
+
+/* Sends a Startup IPI to the processor with local APIC ID
+   APIC_ID, which must be waiting for one after an INIT IPI.  It
+   starts executing in real mode at physical address PADDR, which
+   must be page-aligned and below 1 MB. */
+void
+lapic_send_startup (uint8_t apic_id, uintptr_t paddr) 
+{
+  ASSERT (pg_ofs ((void *) paddr) == 0 && paddr < 0x100000);
+  send_ipi (apic_id, LAPIC_ICR_STARTUP | (paddr >> PGBITS));
+}
+
+/* Sends interrupt VEC to the processor with local APIC ID
+   APIC_ID. */
+void
+lapic_send_ipi (uint8_t apic_id, uint8_t vec) 
+{
+  send_ipi (apic_id, LAPIC_ICR_FIXED | vec);
+}
+
+/* Writes COMMAND, addressed to the processor with local APIC ID
+   APIC_ID, to the interrupt command register, and waits until
+   the local APIC has sent it.  Interrupts must be off, so that
+   nothing else on this CPU uses the register meanwhile. */
+static void
+send_ipi (uint8_t apic_id, uint32_t command) 
+{
+  ASSERT (lapic_enabled ());
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  lapic_write (LAPIC_ICR_HI, (uint32_t) apic_id << LAPIC_ICR_DEST_SHIFT);
+  lapic_write (LAPIC_ICR_LO, command);
+  while (lapic_read (LAPIC_ICR_LO) & LAPIC_ICR_PENDING)
+    continue;
+}
+
+/* Maps the page of memory-mapped I/O registers at physical
+   address PADDR into the kernel's page table, uncached, and
+   returns its kernel virtual address.
+
+   Pintos maps physical memory starting at PHYS_BASE, so MMIO
+   near the top of the 4 GB physical address space cannot be
+   reached through ptov().  Instead we map it at the identical
+   virtual address, which lies in kernel space, well above any
+   RAM that Pintos will ever have. */
+static void *
+map_registers (uintptr_t paddr) 
+{
+  uint8_t *vaddr = (uint8_t *) paddr;
+  uint32_t *pd = init_page_dir;
+  uint32_t *pt;
+
+  ASSERT (pg_ofs (vaddr) == 0);
+  ASSERT (is_kernel_vaddr (vaddr));
+  ASSERT (vtop (vaddr) >= init_ram_pages * PGSIZE);
+
+  if (pd[pd_no (vaddr)] == 0)
+    {
+      pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+      pd[pd_no (vaddr)] = pde_create (pt);
+    }
+  else
+    pt = pde_get_pt (pd[pd_no (vaddr)]);
+  pt[pt_no (vaddr)] = paddr | PTE_P | PTE_W | PTE_PWT | PTE_PCD;
+
+  /* Flush the TLB by reloading CR3. */
+  asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
+
+  return vaddr;
+}
@@ -0,0 +1,35 @@
+#ifndef DEVICES_LAPIC_H
+#define DEVICES_LAPIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Interrupt vector raised by the local APIC timer. */
+#define LAPIC_TIMER_VEC 0xf0
+
+/* Interrupt vector raised by an application processor's local
+   APIC timer, which drives its scheduler. */
+#define LAPIC_AP_TIMER_VEC 0xf1
+
+/* Interrupt vector sent to an idle processor to make it look at
+   the run queue. */
+#define LAPIC_RESCHED_VEC 0xf2
+
+/* Spurious-interrupt vector of the local APIC. */
+#define LAPIC_SPURIOUS_VEC 0xff
+
+bool lapic_init (void);
+void lapic_init_ap (void);
+bool lapic_enabled (void);
+void lapic_eoi (void);
+
+uint32_t lapic_timer_hz (void);
+void lapic_timer_oneshot (uint32_t count);
+void lapic_timer_periodic (uint8_t vec, uint32_t count);
+void lapic_timer_stop (void);
+
+void lapic_send_init (uint8_t apic_id);
+void lapic_send_startup (uint8_t apic_id, uintptr_t paddr);
+void lapic_send_ipi (uint8_t apic_id, uint8_t vec);
+
+#endif /* devices/lapic.h */
@@ -0,0 +1,231 @@
+#include "devices/mp.h"
+#include <debug.h>
+#include <packed.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/loader.h"
+#include "threads/vaddr.h"
+
+/* Discovery of the machine's processors through the tables
+   described in the Intel MultiProcessor Specification, version
+   1.4 [MP].  The BIOS leaves an MP floating pointer structure in
+   low memory, which points to an MP configuration table listing
+   one entry per processor. */
+
+/* MP floating pointer structure. */
+struct mp_fps
+  {
+    char signature[4];          /* "_MP_". */
+    uint32_t config_paddr;      /* Physical address of config table. */
+    uint8_t length;             /* Length in 16-byte paragraphs. */
+    uint8_t spec_rev;           /* Specification revision. */
+    uint8_t checksum;           /* All bytes must sum to 0. */
+    uint8_t default_config;     /* Nonzero: default config, no table. */
+    uint8_t features[4];        /* Miscellaneous feature bits. */
+  } PACKED;
+
+/* MP configuration table header. */
+struct mp_config
+  {
+    char signature[4];          /* "PCMP". */
+    uint16_t length;            /* Length of base table in bytes. */
+    uint8_t spec_rev;           /* Specification revision. */
+    uint8_t checksum;           /* Base table bytes must sum to 0. */
+    char oem_id[8];             /* OEM name. */
+    char product_id[12];        /* Product family name. */
+    uint32_t oem_table_paddr;   /* Optional OEM table. */
+    uint16_t oem_table_size;    /* Size of OEM table. */
+    uint16_t entry_cnt;         /* Number of entries that follow. */
+    uint32_t lapic_paddr;       /* Local APIC base address. */
+    uint16_t ext_length;        /* Length of extended entries. */
+    uint8_t ext_checksum;       /* Checksum of extended entries. */
+    uint8_t reserved;
+  } PACKED;
+
+/* MP configuration table processor entry. */
+struct mp_processor
+  {
+    uint8_t type;               /* MP_ENTRY_PROCESSOR. */
+    uint8_t lapic_id;           /* Local APIC ID. */
+    uint8_t lapic_version;      /* Local APIC version. */
+    uint8_t flags;              /* MP_CPU_* flags. */
+    uint32_t signature;         /* CPU type signature. */
+    uint32_t features;          /* CPUID feature flags. */
+    uint32_t reserved[2];
+  } PACKED;
+
+/* Configuration table entry types and their lengths. */
+#define MP_ENTRY_PROCESSOR 0    /* 20 bytes. */
+#define MP_ENTRY_OTHER_LEN 8    /* Bus, I/O APIC, interrupt entries. */
+
+/* Processor entry flags. */
+#define MP_CPU_ENABLED 0x01     /* Usable. */
+#define MP_CPU_BSP     0x02     /* Bootstrap processor. */
+
+/* Processors found. */
+static uint8_t cpu_apic_ids[MP_MAX_CPUS];
+static int cpu_cnt;
+
+static struct mp_fps *find_fps (void);
+static struct mp_fps *search_fps (uintptr_t paddr, size_t size);
+static void *map_table (uintptr_t paddr, size_t size);
+static bool checksum_ok (const void *, size_t size);
+static void add_cpu (uint8_t apic_id, bool bsp);
+
+/* Looks for the MP tables and records the processors that they
+   describe.  On a machine without MP tables, assumes that there
+   is just the one processor that we are running on.
+
+   The application processors stay halted as the BIOS left them
+   until smp_start() wakes them up. */
+void
+mp_init (void) 
+{
+  struct mp_fps *fps = find_fps ();
+  struct mp_config *config = NULL;
+  const uint8_t *entry;
+  int i;
+
+  if (fps != NULL && fps->default_config == 0)
+    config = map_table (fps->config_paddr, sizeof *config);
+  if (config != NULL
+      && (memcmp (config->signature, "PCMP", 4)
+          || map_table (fps->config_paddr, config->length) == NULL
+          || !checksum_ok (config, config->length)))
+    config = NULL;
+
+  if (config != NULL)
+    {
+      entry = (const uint8_t *) (config + 1);
+      for (i = 0; i < config->entry_cnt; i++)
+        if (*entry == MP_ENTRY_PROCESSOR) 
+          {
+            const struct mp_processor *p = (const void *) entry;
+            if (p->flags & MP_CPU_ENABLED)
+              add_cpu (p->lapic_id, p->flags & MP_CPU_BSP);
+            entry += sizeof *p;
+          }
+        else
+          entry += MP_ENTRY_OTHER_LEN;
+    }
+  else if (fps != NULL)
+    {
+      /* One of the default configurations, all of which have two
+         processors, with local APIC IDs 0 and 1. */
+      add_cpu (0, true);
+      add_cpu (1, false);
+    }
+
+  if (cpu_cnt == 0)
+    {
+      /* No MP tables: a uniprocessor machine. */
+      add_cpu (0, true);
+    }
+
+  if (cpu_cnt > 1)
+    printf ("MP: %d CPUs found.\n", cpu_cnt);
+}
+
+/* Returns the number of processors found by mp_init(). */
+int
+mp_cpu_cnt (void) 
+{
+  return cpu_cnt;
+}
+
+/* Returns the local APIC ID of processor CPU, which must be less
+   than mp_cpu_cnt().  Processor 0 is the bootstrap processor. */
+uint8_t
+mp_cpu_apic_id (int cpu) 
+{
+  ASSERT (cpu >= 0 && cpu < cpu_cnt);
+  return cpu_apic_ids[cpu];
+}
+
+/* Searches the places that [MP] section 4 says the floating
+   pointer structure may be: the first kilobyte of the extended
+   BIOS data area, the last kilobyte of base memory, and the BIOS
+   ROM.  Returns the structure if found, otherwise a null
+   pointer. */
+static struct mp_fps *
+find_fps (void) 
+{
+  /* BIOS data area words. */
+  uint16_t ebda_seg = *(uint16_t *) ptov (0x40e);
+  uint16_t base_kb = *(uint16_t *) ptov (0x413);
+  struct mp_fps *fps = NULL;
+
+  if (ebda_seg != 0)
+    fps = search_fps ((uintptr_t) ebda_seg << 4, 1024);
+  if (fps == NULL && base_kb != 0)
+    fps = search_fps ((uintptr_t) base_kb * 1024 - 1024, 1024);
+  if (fps == NULL)
+    fps = search_fps (0xf0000, 0x10000);
+  return fps;
+}
+
+/* Looks for a valid floating pointer structure, which is always
+   16-byte aligned, in the SIZE bytes starting at physical
+   address PADDR. */
+static struct mp_fps *
+search_fps (uintptr_t paddr, size_t size) 
+{
+  uint8_t *p = map_table (paddr, size);
+  size_t ofs;
+
+  if (p == NULL)
+    return NULL;
+  for (ofs = 0; ofs + sizeof (struct mp_fps) <= size; ofs += 16)
+    {
+      struct mp_fps *fps = (struct mp_fps *) (p + ofs);
+      if (!memcmp (fps->signature, "_MP_", 4)
+          && fps->length * 16 <= size - ofs
+          && checksum_ok (fps, fps->length * 16))
+        return fps;
+    }
+  return NULL;
+}
+
+/* Returns the kernel virtual address of the SIZE bytes at
+   physical address PADDR, or a null pointer if they are not
+   within the RAM that the kernel has mapped. */
+static void *
+map_table (uintptr_t paddr, size_t size) 
+{
+  uintptr_t ram_size = (uintptr_t) init_ram_pages * PGSIZE;
+
+  if (paddr >= ram_size || size > ram_size - paddr)
+    return NULL;
+  return ptov (paddr);
+}
+
+/* Returns true if the SIZE bytes at P sum to 0 mod 256, as MP
+   structures' checksums require. */
+static bool
+checksum_ok (const void *p_, size_t size) 
+{
+  const uint8_t *p = p_;
+  uint8_t sum = 0;
+
+  while (size-- > 0)
+    sum += *p++;
+  return sum == 0;
+}
+
+/* Records a processor with the given local APIC ID, putting the
+   bootstrap processor first. */
+static void
+add_cpu (uint8_t apic_id, bool bsp) 
+{
+  if (cpu_cnt >= MP_MAX_CPUS)
+    return;
+  if (bsp)
+    {
+      memmove (cpu_apic_ids + 1, cpu_apic_ids, cpu_cnt);
+      cpu_apic_ids[0] = apic_id;
+    }
+  else
+    cpu_apic_ids[cpu_cnt] = apic_id;
+  cpu_cnt++;
+}
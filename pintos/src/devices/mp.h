@@ -0,0 +1,13 @@
+#ifndef DEVICES_MP_H
+#define DEVICES_MP_H
+
+#include <stdint.h>
+
+/* Maximum number of processors recorded. */
+#define MP_MAX_CPUS 16
+
+void mp_init (void);
+int mp_cpu_cnt (void);
+uint8_t mp_cpu_apic_id (int cpu);
+
+#endif /* devices/mp.h */
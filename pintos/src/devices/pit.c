@@ -11,8 +11,14 @@
 #define PIT_PORT_CONTROL          0x43                /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
+/* System control port B, which gates channel 2 and reads back
+   its output. */
+#define PIT_PORT_GATE             0x61
+#define PIT_GATE_CHANNEL2         0x01  /* Channel 2 counts if set. */
+#define PIT_GATE_SPEAKER          0x02  /* Channel 2 drives speaker. */
+#define PIT_GATE_OUT2             0x20  /* Channel 2 output (read-only). */
+
+static uint16_t frequency_to_count (int frequency);
 
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
@@ -39,7 +45,8 @@
        it is 1, for the second half it is 0.  This is useful for
        generating a tone on a speaker.
 
-     - Other modes are less useful.
+     - Other modes are less useful.  (Mode 0, a one-shot count,
+       is available through pit_configure_oneshot().)
 
    FREQUENCY is the number of periods per second, in Hz. */
 void
@@ -51,9 +58,97 @@ pit_configure_channel (int channel, int mode, int frequency)
   ASSERT (channel == 0 || channel == 2);
   ASSERT (mode == 2 || mode == 3);
 
-  /* Convert FREQUENCY to a PIT counter value.  The PIT has a
-     clock that runs at PIT_HZ cycles per second.  We must
-     translate FREQUENCY into a number of these cycles. */
+  count = frequency_to_count (frequency);
+
+  /* Configure the PIT mode and load its counters. */
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, (channel << 6) | 0x30 | (mode << 1));
+  outb (PIT_PORT_COUNTER (channel), count);
+  outb (PIT_PORT_COUNTER (channel), count >> 8);
+  intr_set_level (old_level);
+}
+
+/* Configures CHANNEL in the PIT in mode 0, "interrupt on
+   terminal count": the channel counts down once from COUNT and
+   raises its output when it reaches 0, then stays quiet until it
+   is reprogrammed.  On channel 0 this yields a single timer
+   interrupt COUNT PIT cycles from now.  A COUNT of 0 is treated
+   as 65536. */
+void
+pit_configure_oneshot (int channel, uint16_t count)
+{
+  enum intr_level old_level;
+
+  ASSERT (channel == 0);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, (channel << 6) | 0x30 | (0 << 1));
+  outb (PIT_PORT_COUNTER (channel), count);
+  outb (PIT_PORT_COUNTER (channel), count >> 8);
+  intr_set_level (old_level);
+}
+
+/* Returns the current value of CHANNEL's down-counter, that is,
+   the number of PIT cycles until its next output event, latched
+   so that the two bytes are read consistently. */
+uint16_t
+pit_read_counter (int channel)
+{
+  enum intr_level old_level;
+  uint8_t lo, hi;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, channel << 6);
+  lo = inb (PIT_PORT_COUNTER (channel));
+  hi = inb (PIT_PORT_COUNTER (channel));
+  intr_set_level (old_level);
+
+  return lo | (hi << 8);
+}
+
+/* Busy-waits for COUNT cycles of the PIT's clock (COUNT /
+   PIT_HZ seconds), using channel 2 as a one-shot with the
+   speaker disconnected.  This does not depend on interrupts, so
+   it may be called with interrupts off, which makes it a good
+   reference for calibrating other clocks.  A COUNT of 0 is
+   treated as 65536. */
+void
+pit_wait (uint16_t count)
+{
+  enum intr_level old_level;
+  uint8_t gate;
+
+  old_level = intr_disable ();
+  gate = inb (PIT_PORT_GATE);
+  outb (PIT_PORT_GATE, (gate & ~PIT_GATE_SPEAKER) | PIT_GATE_CHANNEL2);
+  outb (PIT_PORT_CONTROL, (2 << 6) | 0x30 | (0 << 1));
+  outb (PIT_PORT_COUNTER (2), count);
+  outb (PIT_PORT_COUNTER (2), count >> 8);
+  while ((inb (PIT_PORT_GATE) & PIT_GATE_OUT2) == 0)
+    continue;
+  outb (PIT_PORT_GATE, gate);
+  intr_set_level (old_level);
+}
+
+/* Returns the number of PIT cycles in one period of a channel
+   configured with pit_configure_channel() for FREQUENCY Hz. */
+unsigned
+pit_period (int frequency)
+{
+  uint16_t count = frequency_to_count (frequency);
+  return count != 0 ? count : 65536;
+}
+
+/* Converts FREQUENCY to a PIT counter value.  The PIT has a
+   clock that runs at PIT_HZ cycles per second.  We must
+   translate FREQUENCY into a number of these cycles. */
+static uint16_t
+frequency_to_count (int frequency)
+{
+  uint16_t count;
+
   if (frequency < 19)
     {
       /* Frequency is too low: the quotient would overflow the
@@ -74,10 +169,5 @@ pit_configure_channel (int channel, int mode, int frequency)
   else
     count = (PIT_HZ + frequency / 2) / frequency;
 
-  /* Configure the PIT mode and load its counters. */
-  old_level = intr_disable ();
-  outb (PIT_PORT_CONTROL, (channel << 6) | 0x30 | (mode << 1));
-  outb (PIT_PORT_COUNTER (channel), count);
-  outb (PIT_PORT_COUNTER (channel), count >> 8);
-  intr_set_level (old_level);
+  return count;
 }
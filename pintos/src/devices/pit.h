@@ -3,6 +3,13 @@
 
 #include <stdint.h>
 
+/* PIT cycles per second. */
+#define PIT_HZ 1193180
+
 void pit_configure_channel (int channel, int mode, int frequency);
+void pit_configure_oneshot (int channel, uint16_t count);
+uint16_t pit_read_counter (int channel);
+unsigned pit_period (int frequency);
+void pit_wait (uint16_t count);
 
 #endif /* devices/pit.h */
@@ -5,7 +5,10 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/interrupt.h"
+#include "threads/profile.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
@@ -94,6 +97,8 @@ shutdown_power_off (void)
   filesys_done ();
 #endif
 
+  trace_dump ();
+  profile_dump ();
   print_stats ();
 
   printf ("Powering off...\n");
@@ -121,6 +126,7 @@ static void
 print_stats (void)
 {
   timer_print_stats ();
+  intr_print_stats ();
   thread_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
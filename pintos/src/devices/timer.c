@@ -1,13 +1,21 @@
 #include "devices/timer.h"
 #include <debug.h>
+#include <heap.h>
+#include <pheap.h>
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include "devices/lapic.h"
+#include "devices/mp.h"
 #include "devices/pit.h"
+#include "devices/tsc.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/profile.h"
+#include "threads/smp.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
-#include "lib/kernel/list.h"
+#include "threads/workqueue.h"
   
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -21,36 +29,171 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
-static struct list waiting_list;
+/* Threads blocked in timer_sleep(), as a min-heap ordered by
+   wakeup tick, so that the timer interrupt can check for expired
+   sleepers in constant time.  Starts out in a static array and
+   moves to a larger malloc()'d one whenever it fills up. */
+#define SLEEPERS_INIT_CNT 64
+static struct heap sleepers;
+static struct heap_elem *sleepers_init_buf[SLEEPERS_INIT_CNT];
+
+/* Threads blocked in a sleep shorter than a tick, as a min-heap
+   ordered by the TSC value to wake up at.  Only used when
+   timer_lapic is true. */
+static struct heap hr_sleepers;
+static struct heap_elem *hr_sleepers_init_buf[SLEEPERS_INIT_CNT];
+
+/* Deadline threads that have used up their runtime, as a pairing
+   heap ordered by the tick at which their next period starts.
+   Unlike the sleeper heaps it never needs to grow, so the
+   scheduler can throttle a thread with interrupts off. */
+static struct pheap throttled;
 
 /* Number of loops per timer tick.
-   Initialized by timer_calibrate(). */
+   Initialized by timer_calibrate(), unless already set with
+   timer_set_loops_per_tick(). */
 static unsigned loops_per_tick;
 
+/* Number of loops timed against the TSC by timer_calibrate(),
+   and how many times to time them. */
+#define TSC_CALIBRATION_LOOPS (1u << 16)
+#define TSC_CALIBRATION_RUNS 3
+
+/* If false (default), the PIT interrupts TIMER_FREQ times per
+   second at all times.
+   If true, the periodic tick is stopped while the CPU is idle.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* Tickless idle state.  While the idle thread halts, channel 0
+   runs as a one-shot that fires on the tick of the earliest
+   sleeper's wakeup, ONESHOT_TICKS ticks after it was programmed.
+   ONESHOT_OFFSET is how far, in PIT cycles, the current tick had
+   progressed at that point, and ONESHOT_COUNT is the count that
+   was loaded.  Together they let us work out how many ticks have
+   really passed if some other interrupt wakes us up early. */
+static bool oneshot;            /* Channel 0 in one-shot mode? */
+static unsigned tick_count;     /* PIT cycles per timer tick. */
+static unsigned oneshot_count;  /* PIT cycles the one-shot was set to. */
+static unsigned oneshot_offset; /* PIT cycles into the tick at setup. */
+static int64_t oneshot_ticks;   /* Ticks until the one-shot fires. */
+static int64_t skipped_ticks;   /* Timer interrupts avoided. */
+
+/* If false (default), the PIT generates the timer tick.
+   If true, the local APIC timer does, in one-shot mode, so that
+   it can also interrupt at the precise TSC deadline of a sleep
+   shorter than a tick.
+   Controlled by kernel command-line option "-lapic". */
+bool timer_lapic;
+
+/* Local APIC tick state. */
+static uint64_t tsc_per_tick;   /* TSC cycles per timer tick. */
+static uint64_t next_tick_tsc;  /* TSC value at the next tick. */
+
+/* TSC value in timer_init(), the zero point of timer_ns(). */
+static uint64_t boot_tsc;
+
+/* Deferred work that wakes up sleepers and throttled threads. */
+static struct work wakeup_work;
+
 static intr_handler_func timer_interrupt;
+static intr_handler_func lapic_timer_interrupt;
+static void tick (void);
+static struct thread *sleeper_due (void);
+static struct thread *throttled_due (void);
+static work_func wake_due_threads;
+static void wake_sleeper (struct thread *);
+static void lapic_program (uint64_t now);
+static void hr_sleep (uint64_t deadline);
+static unsigned calibrate_with_tsc (void);
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
-
-/* Sets up the timer to interrupt TIMER_FREQ times per second,
-   and registers the corresponding interrupt. */
+static heap_less_func wakeup_less;
+static heap_less_func hr_wakeup_less;
+static pheap_less_func throttle_less;
+static bool sleepers_grow (struct heap *, struct heap_elem **init_buf);
+
+/* Calibrates the TSC, sets up the timer to interrupt TIMER_FREQ
+   times per second, and registers the corresponding interrupt.
+   In local APIC mode, falls back to the PIT if the CPU lacks a
+   TSC or a local APIC. */
 void
 timer_init (void) 
 {
-  pit_configure_channel (0, 2, TIMER_FREQ);
+  heap_init (&sleepers, sleepers_init_buf, SLEEPERS_INIT_CNT,
+             wakeup_less, NULL);
+  heap_init (&hr_sleepers, hr_sleepers_init_buf, SLEEPERS_INIT_CNT,
+             hr_wakeup_less, NULL);
+  pheap_init (&throttled, throttle_less, NULL);
+  work_init (&wakeup_work, wake_due_threads);
+
+  tsc_init ();
+  if (tsc_available ())
+    boot_tsc = tsc_read ();
+  if (timer_lapic && !(tsc_available () && lapic_init ()))
+    {
+      printf ("Timer: no local APIC timer, using the PIT instead.\n");
+      timer_lapic = false;
+    }
+
+  tick_count = pit_period (TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
-  list_init(&waiting_list);
+  if (timer_lapic)
+    {
+      /* Silence the PIT: in mode 0 it interrupts just once. */
+      pit_configure_oneshot (0, 0);
+
+      tsc_per_tick = tsc_hz () / TIMER_FREQ;
+      next_tick_tsc = tsc_read () + tsc_per_tick;
+      intr_register_ext (LAPIC_TIMER_VEC, lapic_timer_interrupt,
+                         "LAPIC Timer");
+      lapic_program (tsc_read ());
+    }
+  else
+    pit_configure_channel (0, 2, TIMER_FREQ);
+}
+
+/* Sets loops_per_tick, used to implement brief delays, to
+   LOOPS, so that timer_calibrate() need not measure it.  Kernel
+   command-line option "-lpt" uses this to pass on a value printed
+   by an earlier boot on the same machine. */
+void
+timer_set_loops_per_tick (unsigned loops) 
+{
+  ASSERT (loops > 0);
+  loops_per_tick = loops;
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates loops_per_tick, used to implement brief delays.
+   Does nothing if it was set by timer_set_loops_per_tick().
+   Otherwise times a fixed number of loops with the TSC, which
+   takes well under a millisecond, or, without a TSC, searches for
+   the number of loops that fits in a tick, which takes about 20
+   ticks. */
 void
 timer_calibrate (void) 
 {
   unsigned high_bit, test_bit;
 
   ASSERT (intr_get_level () == INTR_ON);
+
+  if (loops_per_tick != 0)
+    {
+      printf ("Timer: %'"PRIu64" loops/s (-lpt=%u).\n",
+              (uint64_t) loops_per_tick * TIMER_FREQ, loops_per_tick);
+      return;
+    }
+
   printf ("Calibrating timer...  ");
+  if (tsc_available ())
+    {
+      loops_per_tick = calibrate_with_tsc ();
+      printf ("%'"PRIu64" loops/s (-lpt=%u).\n",
+              (uint64_t) loops_per_tick * TIMER_FREQ, loops_per_tick);
+      return;
+    }
 
   /* Approximate loops_per_tick as the largest power-of-two
      still less than one timer tick. */
@@ -67,7 +210,8 @@ timer_calibrate (void)
     if (!too_many_loops (high_bit | test_bit))
       loops_per_tick |= test_bit;
 
-  printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+  printf ("%'"PRIu64" loops/s (-lpt=%u).\n",
+          (uint64_t) loops_per_tick * TIMER_FREQ, loops_per_tick);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -88,14 +232,37 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
-
-static bool 
-sort_by_waiting_ticks (const struct list_elem *a_, const struct list_elem *b_,
-                      void *aux UNUSED) 
+/* Returns the number of nanoseconds since timer_init().  Reads
+   the TSC if there is one.  Otherwise, refines the tick count
+   with the PIT's counter, which is good to about a microsecond.
+   Either way, the result never decreases. */
+int64_t
+timer_ns (void) 
 {
-  const struct thread *a = list_entry (a_, struct thread, elem);
-  const struct thread *b = list_entry (b_, struct thread, elem);
-  return a->waiting_ticks < b->waiting_ticks; 
+  static int64_t last_ns;
+  enum intr_level old_level;
+  int64_t ns;
+
+  if (tsc_available ())
+    return tsc_to_ns (tsc_read () - boot_tsc);
+
+  old_level = intr_disable ();
+  ns = ticks * (1000000000 / TIMER_FREQ);
+  if (!oneshot)
+    {
+      unsigned remaining = pit_read_counter (0);
+      if (remaining > 0 && remaining <= tick_count)
+        ns += (int64_t) (tick_count - remaining) * 1000000000 / PIT_HZ;
+    }
+
+  /* A tick that is due but whose interrupt is still pending
+     would make the time appear to step backward. */
+  if (ns < last_ns)
+    ns = last_ns;
+  last_ns = ns;
+  intr_set_level (old_level);
+
+  return ns;
 }
 
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
@@ -104,21 +271,72 @@ void
 timer_sleep (int64_t ticks) 
 {
   int64_t start = timer_ticks ();
+  struct thread *t = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
 
-  enum intr_level old_level = intr_disable();
-  struct thread * t = thread_current();
-  t->waiting_ticks = start + ticks;
-  //printf("TIMER_SLEEP: tid = %d\n", t->tid);
-  //printf("  start = %"PRId64", ticks = %"PRId64"\n", start, ticks);
-  list_push_back(&waiting_list, &t->elem);
-  list_sort(&waiting_list, sort_by_waiting_ticks, NULL);
-  thread_block();
-  intr_set_level(old_level);
+  if (ticks <= 0)
+    return;
+
+  old_level = intr_disable ();
+  while (heap_full (&sleepers))
+    {
+      intr_set_level (old_level);
+      if (!sleepers_grow (&sleepers, sleepers_init_buf))
+        {
+          /* Out of memory: fall back to polling. */
+          while (timer_elapsed (start) < ticks) 
+            thread_yield ();
+          return;
+        }
+      old_level = intr_disable ();
+    }
+
+  t->wakeup_tick = start + ticks;
+  t->sleep_heap = &sleepers;
+  heap_push (&sleepers, &t->sleep_elem);
+  thread_block ();
+  intr_set_level (old_level);
+}
+
+/* Wakes up thread T before its time if it is blocked in
+   timer_sleep() or one of the other sleep functions.  Returns
+   true if T was sleeping, false otherwise.
+
+   This function may be called from an interrupt handler. */
+bool
+timer_cancel_sleep (struct thread *t) 
+{
+  enum intr_level old_level = intr_disable ();
+  bool was_sleeping = t->sleep_heap != NULL;
+
+  if (was_sleeping)
+    {
+      heap_remove (t->sleep_heap, &t->sleep_elem);
+      t->sleep_heap = NULL;
+      thread_unblock (t);
+    }
+  intr_set_level (old_level);
 
-  //while (timer_elapsed (start) < ticks) 
-  //  thread_yield ();
+  return was_sleeping;
+}
+
+/* Blocks the running thread, a deadline thread that has used up
+   its runtime, until tick UNTIL.  Unlike timer_sleep(), never
+   allocates memory, so the scheduler may call it with interrupts
+   turned off. */
+void
+timer_throttle (int64_t until) 
+{
+  struct thread *t = thread_current ();
+
+  ASSERT (!intr_context ());
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t->wakeup_tick = until;
+  pheap_push (&throttled, &t->throttle_elem);
+  thread_block ();
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -184,44 +402,416 @@ timer_ndelay (int64_t ns)
   real_time_delay (ns, 1000 * 1000 * 1000);
 }
 
+/* Called by the idle thread, with interrupts off, just before
+   it halts the CPU.  In tickless mode, stops the periodic tick
+   and instead programs the PIT to interrupt on the tick at which
+   the first sleeper is due, or as late as the 16-bit counter
+   allows if nobody is sleeping. */
+void
+timer_idle_enter (void) 
+{
+  unsigned remaining, max_ticks;
+  int64_t idle_ticks;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* The local APIC timer is already a one-shot that we reprogram
+     on every interrupt, so it does not take part.  Nor can the
+     tick stop while other CPUs are running threads that look at
+     timer_ticks(). */
+  if (!timer_tickless || timer_lapic || oneshot || smp_cpu_cnt () > 1)
+    return;
+
+  /* PIT cycles left in the current tick. */
+  remaining = pit_read_counter (0);
+  if (remaining == 0 || remaining > tick_count)
+    remaining = tick_count;
+
+  /* Number of tick boundaries we may sleep through. */
+  max_ticks = (65535 - remaining) / tick_count + 1;
+  if (heap_empty (&sleepers))
+    idle_ticks = max_ticks;
+  else
+    {
+      struct thread *t = heap_entry (heap_top (&sleepers),
+                                     struct thread, sleep_elem);
+      idle_ticks = t->wakeup_tick - ticks;
+      if (idle_ticks > max_ticks)
+        idle_ticks = max_ticks;
+    }
+  if (!pheap_empty (&throttled))
+    {
+      struct thread *t = pheap_entry (pheap_top (&throttled),
+                                      struct thread, throttle_elem);
+      if (t->wakeup_tick - ticks < idle_ticks)
+        idle_ticks = t->wakeup_tick - ticks;
+    }
+
+  /* The MLFQS recomputes the load average on each second
+     boundary, so make sure that tick gets its interrupt. */
+  if (thread_mlfqs && idle_ticks > TIMER_FREQ - ticks % TIMER_FREQ)
+    idle_ticks = TIMER_FREQ - ticks % TIMER_FREQ;
+
+  /* Nothing to gain from a one-tick one-shot. */
+  if (idle_ticks <= 1)
+    return;
+
+  oneshot = true;
+  oneshot_ticks = idle_ticks;
+  oneshot_offset = tick_count - remaining;
+  oneshot_count = remaining + (idle_ticks - 1) * tick_count;
+  pit_configure_oneshot (0, oneshot_count);
+}
+
+/* Called by the scheduler, with interrupts off, whenever the
+   idle thread gives up the CPU.  If an interrupt other than the
+   one-shot's woke the CPU up, accounts for the ticks that have passed
+   since timer_idle_enter() and arms the one-shot for the end of
+   the current tick, where timer_interrupt() will restore the
+   periodic tick.  This keeps timer_ticks() exact. */
+void
+timer_idle_exit (void) 
+{
+  unsigned remaining, elapsed;
+  int64_t whole_ticks;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!oneshot || oneshot_ticks <= 1)
+    return;
+
+  /* If the counter has wrapped, the one-shot has fired and its
+     interrupt is pending; timer_interrupt() will handle it. */
+  remaining = pit_read_counter (0);
+  if (remaining == 0 || remaining > oneshot_count)
+    return;
+
+  elapsed = oneshot_offset + (oneshot_count - remaining);
+  whole_ticks = elapsed / tick_count;
+  ticks += whole_ticks;
+  skipped_ticks += whole_ticks;
+  thread_tick_idle (whole_ticks);
+
+  oneshot_ticks = 1;
+  oneshot_count = tick_count - elapsed % tick_count;
+  oneshot_offset = tick_count - oneshot_count;
+  pit_configure_oneshot (0, oneshot_count);
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void) 
 {
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  if (timer_tickless)
+    printf ("Timer: %"PRId64" ticks passed without an interrupt\n",
+            skipped_ticks);
 }
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+timer_interrupt (struct intr_frame *args)
 {
-  ticks++;
+  /* The local APIC is driving the tick.  This is the PIT's final
+     interrupt after timer_init() stopped it. */
+  if (timer_lapic)
+    return;
+
+  profile_sample (args);
 
-  struct thread *t = list_entry(list_begin(&waiting_list), struct thread, elem);
-
-  while (t->waiting_ticks <= ticks && t->tid && t->status != 1)
-  {
-    list_pop_front(&waiting_list);
-    thread_unblock(t);
-/*
-    struct list_elem *w;
-    w = list_begin(&waiting_list);
-    printf("Waiting list priority = (");
-    int i;
-    for (i = 0; i < list_size(&waiting_list); i++)
+  if (oneshot)
     {
-      struct thread *t = list_entry(w, struct thread, elem);
-      printf(" (%d, %d, till %" PRId64 ") ", t->tid, t->priority, t->waiting_ticks);
-      w = list_next(w);
+      /* The one-shot set by timer_idle_enter() has fired: the
+         ticks in between passed while the CPU was idle.  Go back
+         to the periodic tick. */
+      pit_configure_channel (0, 2, TIMER_FREQ);
+      oneshot = false;
+      ticks += oneshot_ticks - 1;
+      skipped_ticks += oneshot_ticks - 1;
+      thread_tick_idle (oneshot_ticks - 1);
     }
-    printf(")\n");
-*/
-    //printf("TIMER_INTERRUPT: tid = %d ticks = %"PRId64" \n", t->tid, ticks);
-    t = list_entry(list_begin(&waiting_list), struct thread, elem);
-  }
+
+  tick ();
+}
+
+/* Local APIC timer interrupt handler.  Runs every tick that is
+   due and wakes up every high-resolution sleeper whose deadline
+   has passed, then arms the timer for whichever comes next.
+   Runs on the BSP only. */
+static void
+lapic_timer_interrupt (struct intr_frame *args)
+{
+  uint64_t now = tsc_read ();
+
+  profile_sample (args);
+
+  while (now >= next_tick_tsc)
+    {
+      next_tick_tsc += tsc_per_tick;
+      tick ();
+    }
+
+  while (!heap_empty (&hr_sleepers))
+    {
+      struct thread *t = heap_entry (heap_top (&hr_sleepers),
+                                     struct thread, sleep_elem);
+      if (t->wakeup_tsc > now)
+        break;
+      wake_sleeper (t);
+    }
+
+  lapic_program (now);
+}
+
+/* Advances the tick count and, if a sleeper or throttled thread
+   is due, defers waking it up to wakeup_work.  Called from an
+   interrupt handler. */
+static void
+tick (void) 
+{
+  ticks++;
+
+  if (sleeper_due () != NULL || throttled_due () != NULL)
+    intr_defer (&wakeup_work);
   thread_tick ();
 }
 
+/* Returns the earliest sleeper if its time has come, otherwise a
+   null pointer.  Interrupts must be off. */
+static struct thread *
+sleeper_due (void) 
+{
+  struct thread *t;
+
+  if (heap_empty (&sleepers))
+    return NULL;
+  t = heap_entry (heap_top (&sleepers), struct thread, sleep_elem);
+  return t->wakeup_tick <= ticks ? t : NULL;
+}
+
+/* Returns the earliest throttled thread if its time has come,
+   otherwise a null pointer.  Interrupts must be off. */
+static struct thread *
+throttled_due (void) 
+{
+  struct thread *t;
+
+  if (pheap_empty (&throttled))
+    return NULL;
+  t = pheap_entry (pheap_top (&throttled), struct thread, throttle_elem);
+  return t->wakeup_tick <= ticks ? t : NULL;
+}
+
+/* Wakes up every sleeper and throttled thread whose time has
+   come.  Runs as deferred work raised by tick(), with interrupts
+   on, turning them off only long enough to wake one thread at a
+   time, so that many threads waking up at the same tick does not
+   hold off other interrupts. */
+static void
+wake_due_threads (struct work *w UNUSED) 
+{
+  for (;;) 
+    {
+      enum intr_level old_level = intr_disable ();
+      struct thread *t = sleeper_due ();
+      if (t != NULL)
+        wake_sleeper (t);
+      else 
+        {
+          t = throttled_due ();
+          if (t != NULL) 
+            {
+              pheap_pop (&throttled);
+              thread_unblock (t);
+              if (thread_preempts (t))
+                intr_yield_on_return ();
+            }
+        }
+      intr_set_level (old_level);
+
+      if (t == NULL)
+        break;
+    }
+}
+
+/* Wakes up sleeping thread T from an interrupt handler,
+   preempting the running thread if T should run first. */
+static void
+wake_sleeper (struct thread *t) 
+{
+  heap_remove (t->sleep_heap, &t->sleep_elem);
+  t->sleep_heap = NULL;
+  thread_unblock (t);
+  if (thread_preempts (t))
+    intr_yield_on_return ();
+}
+
+/* Arms the local APIC timer for the next tick or the earliest
+   high-resolution sleeper's deadline, whichever comes first.
+   NOW is the current TSC value.  Interrupts must be off, and
+   we must be on the BSP. */
+static void
+lapic_program (uint64_t now) 
+{
+  uint64_t deadline = next_tick_tsc;
+  uint64_t count = 1;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!heap_empty (&hr_sleepers))
+    {
+      struct thread *t = heap_entry (heap_top (&hr_sleepers),
+                                     struct thread, sleep_elem);
+      if (t->wakeup_tsc < deadline)
+        deadline = t->wakeup_tsc;
+    }
+
+  /* Round up, so that we do not wake up just short of the
+     deadline and have to go around again. */
+  if (deadline > now)
+    count = ((deadline - now) * lapic_timer_hz () + tsc_hz () - 1)
+            / tsc_hz ();
+  lapic_timer_oneshot (count);
+}
+
+/* Blocks the current thread until the TSC reaches DEADLINE,
+   using the local APIC timer to wake it up.  Interrupts must be
+   turned on. */
+static void
+hr_sleep (uint64_t deadline) 
+{
+  struct thread *t = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  old_level = intr_disable ();
+  while (heap_full (&hr_sleepers))
+    {
+      intr_set_level (old_level);
+      if (!sleepers_grow (&hr_sleepers, hr_sleepers_init_buf))
+        {
+          /* Out of memory: fall back to polling. */
+          while (tsc_read () < deadline) 
+            thread_yield ();
+          return;
+        }
+      old_level = intr_disable ();
+    }
+
+  t->wakeup_tsc = deadline;
+  t->sleep_heap = &hr_sleepers;
+  heap_push (&hr_sleepers, &t->sleep_elem);
+
+  /* Only the BSP's local APIC timer wakes up high-resolution
+     sleepers.  An AP's drives its scheduler tick instead, so an
+     AP has the BSP rearm its own timer by raising its timer
+     interrupt there. */
+  if (smp_cpu_id () == 0)
+    lapic_program (tsc_read ());
+  else
+    lapic_send_ipi (mp_cpu_apic_id (0), LAPIC_TIMER_VEC);
+  thread_block ();
+  intr_set_level (old_level);
+}
+
+/* Orders sleeping threads by wakeup tick. */
+static bool
+wakeup_less (const struct heap_elem *a_, const struct heap_elem *b_,
+             void *aux UNUSED) 
+{
+  const struct thread *a = heap_entry (a_, struct thread, sleep_elem);
+  const struct thread *b = heap_entry (b_, struct thread, sleep_elem);
+  return a->wakeup_tick < b->wakeup_tick;
+}
+
+/* Orders high-resolution sleepers by wakeup TSC value. */
+static bool
+hr_wakeup_less (const struct heap_elem *a_, const struct heap_elem *b_,
+                void *aux UNUSED) 
+{
+  const struct thread *a = heap_entry (a_, struct thread, sleep_elem);
+  const struct thread *b = heap_entry (b_, struct thread, sleep_elem);
+  return a->wakeup_tsc < b->wakeup_tsc;
+}
+
+/* Orders throttled threads by the tick to wake up at. */
+static bool
+throttle_less (const struct pheap_elem *a_, const struct pheap_elem *b_,
+               void *aux UNUSED) 
+{
+  const struct thread *a = pheap_entry (a_, struct thread, throttle_elem);
+  const struct thread *b = pheap_entry (b_, struct thread, throttle_elem);
+  return a->wakeup_tick < b->wakeup_tick;
+}
+
+/* Doubles the capacity of sleeper heap H, whose first array was
+   INIT_BUF.  Returns true if successful, false if memory is
+   exhausted.
+
+   The new array is allocated with interrupts on, because
+   malloc() may sleep, and swapped in with interrupts off, because
+   the timer interrupt may be using the heap. */
+static bool
+sleepers_grow (struct heap *h, struct heap_elem **init_buf) 
+{
+  enum intr_level old_level;
+  struct heap_elem **buf, **old_buf;
+  size_t capacity;
+
+  old_level = intr_disable ();
+  capacity = heap_capacity (h) * 2;
+  intr_set_level (old_level);
+
+  buf = malloc (capacity * sizeof *buf);
+  if (buf == NULL)
+    return false;
+
+  old_level = intr_disable ();
+  if (capacity > heap_capacity (h))
+    old_buf = heap_set_buffer (h, buf, capacity);
+  else
+    {
+      /* Another thread grew the heap while we were allocating. */
+      old_buf = buf;
+    }
+  intr_set_level (old_level);
+
+  if (old_buf != init_buf)
+    free (old_buf);
+  return true;
+}
+
+/* Returns the number of loops per timer tick, computed from the
+   time busy_wait() takes for TSC_CALIBRATION_LOOPS loops.  Takes
+   the fastest of several runs, since anything that slows a run
+   down, such as a cold cache, only makes it less representative. */
+static unsigned
+calibrate_with_tsc (void) 
+{
+  uint64_t fastest = UINT64_MAX;
+  int i;
+
+  for (i = 0; i < TSC_CALIBRATION_RUNS; i++) 
+    {
+      enum intr_level old_level = intr_disable ();
+      uint64_t start = tsc_read ();
+      uint64_t cycles;
+
+      busy_wait (TSC_CALIBRATION_LOOPS);
+      cycles = tsc_read () - start;
+      intr_set_level (old_level);
+
+      if (cycles < fastest)
+        fastest = cycles;
+    }
+  if (fastest == 0)
+    fastest = 1;
+
+  return (uint64_t) TSC_CALIBRATION_LOOPS * (tsc_hz () / TIMER_FREQ)
+         / fastest;
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
@@ -275,6 +865,13 @@ real_time_sleep (int64_t num, int32_t denom)
          processes. */                
       timer_sleep (ticks); 
     }
+  else if (timer_lapic)
+    {
+      /* The local APIC timer can wake us up at a precise TSC
+         deadline, so block rather than spin.  NUM / DENOM is
+         less than a tick, so NUM * 1e9 cannot overflow. */
+      hr_sleep (tsc_read () + tsc_from_ns (num * 1000000000 / denom));
+    }
   else 
     {
       /* Otherwise, use a busy-wait loop for more accurate
@@ -2,28 +2,45 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
+struct thread;
+
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* If true, stop the periodic tick while the CPU is idle. */
+extern bool timer_tickless;
+
+/* If true, drive the tick from the local APIC timer. */
+extern bool timer_lapic;
+
 void timer_init (void);
 void timer_calibrate (void);
+void timer_set_loops_per_tick (unsigned loops);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
+int64_t timer_ns (void);
 
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep (int64_t ticks);
 void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
+bool timer_cancel_sleep (struct thread *);
+void timer_throttle (int64_t until);
 
 /* Busy waits. */
 void timer_mdelay (int64_t milliseconds);
 void timer_udelay (int64_t microseconds);
 void timer_ndelay (int64_t nanoseconds);
 
+/* Tickless idle. */
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+
 void timer_print_stats (void);
 
 #endif /* devices/timer.h */
@@ -0,0 +1,86 @@
+#include "devices/tsc.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/pit.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+
+/* Time stamp counter (TSC) clock source.
+
+   The TSC counts CPU cycles, so reading it is cheap and has far
+   better resolution than the PIT, but its rate is not known in
+   advance.  tsc_init() measures it against the PIT at boot. */
+
+/* Length of the calibration interval, in PIT cycles (about 10
+   ms).  With the PIT's resolution of under a microsecond, that
+   is accurate to better than 0.01%. */
+#define CALIBRATION_PIT_CYCLES (PIT_HZ / 100)
+
+/* TSC cycles per second, or 0 if there is no usable TSC. */
+static uint64_t cycles_per_sec;
+
+/* Checks for a TSC and, if there is one, measures its frequency
+   against the PIT.  Interrupts must be off, so that the
+   measurement is not disturbed. */
+void
+tsc_init (void) 
+{
+  uint64_t start, elapsed;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!cpu_has (CPUID_TSC))
+    {
+      printf ("TSC: not available.\n");
+      return;
+    }
+
+  start = rdtsc ();
+  pit_wait (CALIBRATION_PIT_CYCLES);
+  elapsed = rdtsc () - start;
+
+  cycles_per_sec = elapsed * PIT_HZ / CALIBRATION_PIT_CYCLES;
+  printf ("TSC: %'"PRIu64" cycles/s.\n", cycles_per_sec);
+}
+
+/* Returns true if the TSC was found and calibrated. */
+bool
+tsc_available (void) 
+{
+  return cycles_per_sec != 0;
+}
+
+/* Returns the current TSC value.  The TSC must be available. */
+uint64_t
+tsc_read (void) 
+{
+  ASSERT (tsc_available ());
+  return rdtsc ();
+}
+
+/* Returns the number of TSC cycles per second. */
+uint64_t
+tsc_hz (void) 
+{
+  return cycles_per_sec;
+}
+
+/* Converts CYCLES TSC cycles to nanoseconds.  The division is
+   split so that the intermediate products cannot overflow. */
+uint64_t
+tsc_to_ns (uint64_t cycles) 
+{
+  ASSERT (tsc_available ());
+  return (cycles / cycles_per_sec) * 1000000000
+         + (cycles % cycles_per_sec) * 1000000000 / cycles_per_sec;
+}
+
+/* Converts NS nanoseconds to TSC cycles, rounding down. */
+uint64_t
+tsc_from_ns (uint64_t ns) 
+{
+  ASSERT (tsc_available ());
+  return (ns / 1000000000) * cycles_per_sec
+         + (ns % 1000000000) * cycles_per_sec / 1000000000;
+}
@@ -0,0 +1,15 @@
+#ifndef DEVICES_TSC_H
+#define DEVICES_TSC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+void tsc_init (void);
+bool tsc_available (void);
+uint64_t tsc_read (void);
+uint64_t tsc_hz (void);
+
+uint64_t tsc_to_ns (uint64_t cycles);
+uint64_t tsc_from_ns (uint64_t ns);
+
+#endif /* devices/tsc.h */
@@ -0,0 +1,183 @@
+#include "heap.h"
+#include <debug.h>
+#include <string.h>
+
+static void swap (struct heap *, size_t i, size_t j);
+static bool less (const struct heap *, size_t i, size_t j);
+static void sift_up (struct heap *, size_t i);
+static void sift_down (struct heap *, size_t i);
+
+/* Initializes heap H to use the CAPACITY-element array BUF for
+   storage, comparing elements with the given LESS function and
+   auxiliary data AUX.  BUF must remain valid as long as H uses
+   it. */
+void
+heap_init (struct heap *h, struct heap_elem **buf, size_t capacity,
+           heap_less_func *less, void *aux)
+{
+  ASSERT (h != NULL);
+  ASSERT (buf != NULL || capacity == 0);
+  ASSERT (less != NULL);
+
+  h->elem_cnt = 0;
+  h->capacity = capacity;
+  h->elems = buf;
+  h->less = less;
+  h->aux = aux;
+}
+
+/* Moves H's elements into the CAPACITY-element array BUF, which
+   must be large enough to hold them, and returns the array H
+   used before.  Useful for growing a heap: the caller allocates
+   a larger array, swaps it in, and frees the old one. */
+struct heap_elem **
+heap_set_buffer (struct heap *h, struct heap_elem **buf, size_t capacity)
+{
+  struct heap_elem **old = h->elems;
+
+  ASSERT (capacity >= h->elem_cnt);
+
+  if (h->elem_cnt > 0)
+    memcpy (buf, h->elems, h->elem_cnt * sizeof *buf);
+  h->elems = buf;
+  h->capacity = capacity;
+  return old;
+}
+
+/* Inserts E into H.  H must not be full. */
+void
+heap_push (struct heap *h, struct heap_elem *e)
+{
+  ASSERT (e != NULL);
+  ASSERT (!heap_full (h));
+
+  e->index = h->elem_cnt++;
+  h->elems[e->index] = e;
+  sift_up (h, e->index);
+}
+
+/* Returns the least element in H, or a null pointer if H is
+   empty. */
+struct heap_elem *
+heap_top (const struct heap *h)
+{
+  return h->elem_cnt > 0 ? h->elems[0] : NULL;
+}
+
+/* Removes and returns the least element in H, which must not be
+   empty. */
+struct heap_elem *
+heap_pop (struct heap *h)
+{
+  struct heap_elem *top;
+
+  ASSERT (!heap_empty (h));
+
+  top = h->elems[0];
+  heap_remove (h, top);
+  return top;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e)
+{
+  size_t i = e->index;
+
+  ASSERT (i < h->elem_cnt && h->elems[i] == e);
+
+  h->elem_cnt--;
+  if (i != h->elem_cnt)
+    {
+      /* Fill the hole with the last element, which may need to
+         move either up or down from there. */
+      h->elems[i] = h->elems[h->elem_cnt];
+      h->elems[i]->index = i;
+      sift_up (h, i);
+      sift_down (h, i);
+    }
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (const struct heap *h)
+{
+  return h->elem_cnt;
+}
+
+/* Returns the number of elements H can hold. */
+size_t
+heap_capacity (const struct heap *h)
+{
+  return h->capacity;
+}
+
+/* Returns true if H is empty, false otherwise. */
+bool
+heap_empty (const struct heap *h)
+{
+  return h->elem_cnt == 0;
+}
+
+/* Returns true if H is full, false otherwise. */
+bool
+heap_full (const struct heap *h)
+{
+  return h->elem_cnt >= h->capacity;
+}
+
+/* Exchanges the elements at positions I and J in H. */
+static void
+swap (struct heap *h, size_t i, size_t j)
+{
+  struct heap_elem *t = h->elems[i];
+  h->elems[i] = h->elems[j];
+  h->elems[j] = t;
+  h->elems[i]->index = i;
+  h->elems[j]->index = j;
+}
+
+/* Returns true if the element at position I in H is less than
+   the one at position J. */
+static bool
+less (const struct heap *h, size_t i, size_t j)
+{
+  return h->less (h->elems[i], h->elems[j], h->aux);
+}
+
+/* Moves the element at position I in H toward the root until
+   its parent is not greater than it. */
+static void
+sift_up (struct heap *h, size_t i)
+{
+  while (i > 0)
+    {
+      size_t parent = (i - 1) / 2;
+      if (!less (h, i, parent))
+        break;
+      swap (h, i, parent);
+      i = parent;
+    }
+}
+
+/* Moves the element at position I in H toward the leaves until
+   neither child is less than it. */
+static void
+sift_down (struct heap *h, size_t i)
+{
+  for (;;)
+    {
+      size_t left = 2 * i + 1;
+      size_t right = left + 1;
+      size_t least = i;
+
+      if (left < h->elem_cnt && less (h, left, least))
+        least = left;
+      if (right < h->elem_cnt && less (h, right, least))
+        least = right;
+      if (least == i)
+        break;
+      swap (h, i, least);
+      i = least;
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Binary min-heap.
+
+   A heap keeps its elements partially ordered so that the least
+   element, according to a caller-supplied comparison function,
+   can be found in constant time and inserted or removed in
+   O(log n) time.
+
+   Like lists and hash tables, the heap does not allocate its
+   elements: each structure that can be in a heap must embed a
+   struct heap_elem member, and heap_entry converts a struct
+   heap_elem back to the structure that contains it.  The array
+   of element pointers is also supplied by the caller, with
+   heap_init() and heap_set_buffer(), so heap operations never
+   allocate memory and may be used with interrupts disabled or
+   from an interrupt handler.
+
+   Each element remembers its position in the array, so an
+   arbitrary element can also be removed in O(log n) time. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem
+  {
+    size_t index;               /* Position in the heap array. */
+  };
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)                   \
+        ((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->index            \
+                     - offsetof (STRUCT, MEMBER.index)))
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Heap. */
+struct heap
+  {
+    size_t elem_cnt;            /* Number of elements in heap. */
+    size_t capacity;            /* Number of slots in `elems'. */
+    struct heap_elem **elems;   /* Array of `capacity' slots. */
+    heap_less_func *less;       /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+/* Basic life cycle. */
+void heap_init (struct heap *, struct heap_elem **buf, size_t capacity,
+                heap_less_func *, void *aux);
+struct heap_elem **heap_set_buffer (struct heap *, struct heap_elem **buf,
+                                    size_t capacity);
+
+/* Heap elements. */
+void heap_push (struct heap *, struct heap_elem *);
+struct heap_elem *heap_top (const struct heap *);
+struct heap_elem *heap_pop (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+
+/* Information. */
+size_t heap_size (const struct heap *);
+size_t heap_capacity (const struct heap *);
+bool heap_empty (const struct heap *);
+bool heap_full (const struct heap *);
+
+#endif /* lib/kernel/heap.h */
@@ -0,0 +1,159 @@
+#include "pheap.h"
+#include <debug.h>
+
+/* See [Fredman86] for the data structure and its analysis:
+   M. L. Fredman, R. Sedgewick, D. D. Sleator, and R. E. Tarjan,
+   "The pairing heap: A new form of self-adjusting heap",
+   Algorithmica 1:111-129, 1986.
+
+   Each element's `child' points to its first child, `next' to
+   its next sibling, and `prev' to its previous sibling or, for a
+   first child, to its parent.  The root's `next' and `prev' are
+   null. */
+
+static struct pheap_elem *meld (struct pheap *, struct pheap_elem *a,
+                                struct pheap_elem *b);
+static struct pheap_elem *merge_pairs (struct pheap *,
+                                       struct pheap_elem *first);
+
+/* Initializes H as an empty pairing heap that compares elements
+   with the given LESS function and auxiliary data AUX. */
+void
+pheap_init (struct pheap *h, pheap_less_func *less, void *aux)
+{
+  ASSERT (h != NULL);
+  ASSERT (less != NULL);
+
+  h->root = NULL;
+  h->less = less;
+  h->aux = aux;
+}
+
+/* Inserts E into H. */
+void
+pheap_push (struct pheap *h, struct pheap_elem *e)
+{
+  ASSERT (e != NULL);
+
+  e->child = e->next = e->prev = NULL;
+  h->root = h->root != NULL ? meld (h, h->root, e) : e;
+}
+
+/* Returns the least element in H, or a null pointer if H is
+   empty. */
+struct pheap_elem *
+pheap_top (const struct pheap *h)
+{
+  return h->root;
+}
+
+/* Removes and returns the least element in H, which must not be
+   empty. */
+struct pheap_elem *
+pheap_pop (struct pheap *h)
+{
+  struct pheap_elem *top = h->root;
+
+  ASSERT (top != NULL);
+
+  h->root = merge_pairs (h, top->child);
+  return top;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+pheap_remove (struct pheap *h, struct pheap_elem *e)
+{
+  struct pheap_elem *subtree;
+
+  ASSERT (h->root != NULL);
+
+  if (e == h->root)
+    {
+      pheap_pop (h);
+      return;
+    }
+
+  /* Cut E's subtree out of its parent's list of children. */
+  ASSERT (e->prev != NULL);
+  if (e->prev->child == e)
+    e->prev->child = e->next;
+  else
+    e->prev->next = e->next;
+  if (e->next != NULL)
+    e->next->prev = e->prev;
+
+  /* Put E's children back. */
+  subtree = merge_pairs (h, e->child);
+  if (subtree != NULL)
+    h->root = meld (h, h->root, subtree);
+}
+
+/* Returns true if H is empty, false otherwise. */
+bool
+pheap_empty (const struct pheap *h)
+{
+  return h->root == NULL;
+}
+
+/* Combines the trees rooted at A and B, which must not have
+   siblings, into one, and returns its root. */
+static struct pheap_elem *
+meld (struct pheap *h, struct pheap_elem *a, struct pheap_elem *b)
+{
+  if (h->less (b, a, h->aux))
+    {
+      struct pheap_elem *t = a;
+      a = b;
+      b = t;
+    }
+
+  /* Make B the first child of A. */
+  b->prev = a;
+  b->next = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  a->child = b;
+  return a;
+}
+
+/* Combines FIRST and its siblings into a single tree and returns
+   its root, or a null pointer if FIRST is null.  Melds the trees
+   in pairs from left to right, then melds the results from right
+   to left, which is what gives the pairing heap its amortized
+   bounds. */
+static struct pheap_elem *
+merge_pairs (struct pheap *h, struct pheap_elem *first)
+{
+  struct pheap_elem *pairs = NULL;
+  struct pheap_elem *root = NULL;
+
+  /* First pass: meld adjacent pairs, stacking up the results,
+     linked through `next', in reverse order. */
+  while (first != NULL)
+    {
+      struct pheap_elem *a = first;
+      struct pheap_elem *b = a->next;
+
+      first = b != NULL ? b->next : NULL;
+      a->next = a->prev = NULL;
+      if (b != NULL)
+        {
+          b->next = b->prev = NULL;
+          a = meld (h, a, b);
+        }
+      a->next = pairs;
+      pairs = a;
+    }
+
+  /* Second pass: meld the stacked trees together. */
+  while (pairs != NULL)
+    {
+      struct pheap_elem *next = pairs->next;
+
+      pairs->next = NULL;
+      root = root != NULL ? meld (h, root, pairs) : pairs;
+      pairs = next;
+    }
+  return root;
+}
@@ -0,0 +1,67 @@
+#ifndef __LIB_KERNEL_PHEAP_H
+#define __LIB_KERNEL_PHEAP_H
+
+/* Pairing heap.
+
+   A pairing heap is a heap-ordered tree in which each node keeps
+   its children in a linked list.  The least element, according
+   to a caller-supplied comparison function, is at the root.
+   Insertion takes constant time; removing the least element, or
+   any other element, takes O(log n) amortized time.
+
+   Unlike the binary heap in heap.h, a pairing heap is made
+   entirely of links embedded in its elements, like a list, so it
+   has no fixed capacity and never allocates memory.  Each
+   structure that can be in a pairing heap must embed a struct
+   pheap_elem member, and pheap_entry converts a struct
+   pheap_elem back to the structure that contains it.
+
+   The comparison function must give the same answers for as
+   long as an element is in the heap.  To change an element's
+   key, remove it, change the key, and insert it again. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Pairing heap element. */
+struct pheap_elem
+  {
+    struct pheap_elem *child;   /* First child. */
+    struct pheap_elem *next;    /* Next sibling. */
+    struct pheap_elem *prev;    /* Previous sibling, or parent. */
+  };
+
+/* Converts pointer to pairing heap element PHEAP_ELEM into a
+   pointer to the structure that PHEAP_ELEM is embedded inside.
+   Supply the name of the outer structure STRUCT and the member
+   name MEMBER of the pairing heap element. */
+#define pheap_entry(PHEAP_ELEM, STRUCT, MEMBER)                 \
+        ((STRUCT *) ((uint8_t *) &(PHEAP_ELEM)->child           \
+                     - offsetof (STRUCT, MEMBER.child)))
+
+/* Compares the value of two pairing heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool pheap_less_func (const struct pheap_elem *a,
+                              const struct pheap_elem *b,
+                              void *aux);
+
+/* Pairing heap. */
+struct pheap
+  {
+    struct pheap_elem *root;    /* Least element, or null. */
+    pheap_less_func *less;      /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void pheap_init (struct pheap *, pheap_less_func *, void *aux);
+
+void pheap_push (struct pheap *, struct pheap_elem *);
+struct pheap_elem *pheap_top (const struct pheap *);
+struct pheap_elem *pheap_pop (struct pheap *);
+void pheap_remove (struct pheap *, struct pheap_elem *);
+
+bool pheap_empty (const struct pheap *);
+
+#endif /* lib/kernel/pheap.h */
@@ -28,7 +28,10 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Scheduling. */
+    SYS_SET_TICKETS             /* Set share of CPU under -stride. */
   };
 
 #endif /* lib/syscall-nr.h */
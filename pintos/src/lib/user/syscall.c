@@ -182,3 +182,9 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+bool
+set_tickets (int tickets) 
+{
+  return syscall1 (SYS_SET_TICKETS, tickets);
+}
@@ -0,0 +1,66 @@
+/* Puts a thread to sleep for a long time, then cancels the
+   sleep with timer_cancel_sleep() and checks that the thread
+   woke up right away.  Also checks that cancelling a thread
+   that is not sleeping does nothing. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Shared between the test and the sleeper thread. */
+struct cancel_test 
+  {
+    struct thread *sleeper;     /* The sleeping thread. */
+    struct semaphore started;   /* Upped just before sleeping. */
+    struct semaphore done;      /* Upped after waking up. */
+    int64_t slept;              /* Ticks actually slept. */
+  };
+
+static thread_func sleeper;
+
+void
+test_alarm_cancel (void) 
+{
+  struct cancel_test test;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&test.started, 0);
+  sema_init (&test.done, 0);
+  thread_create ("sleeper", PRI_DEFAULT, sleeper, &test);
+  sema_down (&test.started);
+
+  /* Let the sleeper go to sleep, then cancel. */
+  timer_sleep (10);
+  msg ("cancelling sleep");
+  if (!timer_cancel_sleep (test.sleeper))
+    fail ("sleeper was not sleeping");
+  sema_down (&test.done);
+
+  if (test.slept >= 1000)
+    fail ("sleeper slept %lld ticks despite cancellation", test.slept);
+  msg ("sleeper woke up early");
+
+  if (timer_cancel_sleep (thread_current ()))
+    fail ("running thread reported as sleeping");
+  pass ();
+}
+
+static void
+sleeper (void *test_) 
+{
+  struct cancel_test *test = test_;
+  int64_t start;
+
+  test->sleeper = thread_current ();
+  sema_up (&test->started);
+
+  start = timer_ticks ();
+  timer_sleep (1000);
+  test->slept = timer_elapsed (start);
+  sema_up (&test->done);
+}
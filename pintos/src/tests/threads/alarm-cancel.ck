@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-cancel) begin
+(alarm-cancel) cancelling sleep
+(alarm-cancel) sleeper woke up early
+(alarm-cancel) PASS
+(alarm-cancel) end
+EOF
+pass;
@@ -0,0 +1,92 @@
+/* Checks the high-resolution clock and sub-tick sleeps, with the
+   tick driven by the local APIC timer (-lapic).
+
+   First reads timer_ns() repeatedly within a single tick and
+   checks that it never goes backward and resolves well below a
+   tick.  Then sleeps for much less than a tick with
+   timer_usleep() and checks that each sleep lasts at least as
+   long as requested and lets a lower-priority thread run, which
+   means that the sleep blocked instead of spinning. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of sub-tick sleeps. */
+#define SLEEP_CNT 20
+
+/* Length of each sleep, in microseconds. */
+#define SLEEP_US 500
+
+/* Minimum number of distinct timer_ns() values within a tick. */
+#define MIN_DISTINCT 10
+
+static thread_func spinner;
+
+/* Counts iterations of spinner(). */
+static volatile int64_t spins;
+
+/* Set to stop spinner(). */
+static volatile bool stop;
+
+void
+test_alarm_hires (void) 
+{
+  int64_t start, prev, now;
+  int distinct;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Start on a tick boundary, then sample for one tick. */
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    continue;
+  start = timer_ticks ();
+  prev = timer_ns ();
+  distinct = 0;
+  while (timer_ticks () == start)
+    {
+      now = timer_ns ();
+      if (now < prev)
+        fail ("timer_ns() went backward");
+      if (now != prev)
+        distinct++;
+      prev = now;
+    }
+  if (distinct < MIN_DISTINCT)
+    fail ("only %d distinct timer_ns() values within a tick", distinct);
+  msg ("timer_ns() resolves below a tick");
+
+  thread_create ("spinner", PRI_DEFAULT - 1, spinner, NULL);
+  for (i = 0; i < SLEEP_CNT; i++) 
+    {
+      int64_t spins_before = spins;
+      int64_t slept;
+
+      start = timer_ns ();
+      timer_usleep (SLEEP_US);
+      slept = timer_ns () - start;
+
+      if (slept < SLEEP_US * 1000)
+        fail ("sleep %d lasted only %"PRId64" ns", i, slept);
+      if (spins == spins_before)
+        fail ("sleep %d did not let another thread run", i);
+    }
+  msg ("%d sub-tick sleeps blocked for long enough", SLEEP_CNT);
+
+  stop = true;
+  timer_sleep (1);
+  pass ();
+}
+
+static void
+spinner (void *aux UNUSED) 
+{
+  while (!stop)
+    spins++;
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-hires) begin
+(alarm-hires) timer_ns() resolves below a tick
+(alarm-hires) 20 sub-tick sleeps blocked for long enough
+(alarm-hires) PASS
+(alarm-hires) end
+EOF
+pass;
@@ -0,0 +1,59 @@
+/* Checks admission control for deadline threads.
+
+   Deadline threads are admitted only while the sum of their
+   runtime/deadline densities stays within 95% of the CPU.
+   Creates threads of density 40% and 50%, which fit, and then
+   one of 10%, which does not.  Once the 50% thread has exited,
+   the 10% thread fits. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func wait_thread;
+static void create (const char *name, int64_t runtime, struct semaphore *);
+
+void
+test_deadline_admit (void)
+{
+  struct semaphore release, quit;
+
+  sema_init (&release, 0);
+  sema_init (&quit, 0);
+
+  create ("40%", 4, &quit);
+  create ("50%", 5, &release);
+  create ("10%", 1, &quit);
+
+  /* A deadline thread runs ahead of us, so the 50% thread has
+     exited by the time sema_up() returns. */
+  msg ("Releasing 50%% thread.");
+  sema_up (&release);
+
+  create ("10%", 1, &quit);
+
+  sema_up (&quit);
+  sema_up (&quit);
+}
+
+/* Tries to create a deadline thread with RUNTIME ticks of
+   runtime every 10 ticks, which waits on SEMA and then exits. */
+static void
+create (const char *name, int64_t runtime, struct semaphore *sema)
+{
+  if (thread_create_deadline (name, runtime, 10, 10,
+                              wait_thread, sema) != TID_ERROR)
+    msg ("%s thread admitted.", name);
+  else
+    msg ("%s thread rejected.", name);
+}
+
+static void
+wait_thread (void *sema_)
+{
+  struct semaphore *sema = sema_;
+
+  sema_down (sema);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(deadline-admit) begin
+(deadline-admit) 40% thread admitted.
+(deadline-admit) 50% thread admitted.
+(deadline-admit) 10% thread rejected.
+(deadline-admit) Releasing 50% thread.
+(deadline-admit) 10% thread admitted.
+(deadline-admit) end
+EOF
+pass;
@@ -0,0 +1,128 @@
+/* Counts missed deadlines of periodic deadline threads running
+   against a CPU-bound background load.
+
+   Starts BG_CNT threads at PRI_MAX that spin until the test is
+   over, and then two deadline threads:
+
+     - "dl fast": 3 ticks of runtime every 10 ticks, deadline 10.
+     - "dl slow": 4 ticks of runtime every 20 ticks, deadline 15.
+
+   Each deadline thread does one tick less work per period than
+   its runtime, for JOB_CNT periods, and counts the periods in
+   which thread_deadline_yield() reports a missed deadline.  The
+   deadline threads need well under the whole CPU, so with EDF
+   ahead of the priority scheduler none of their deadlines should
+   be missed, however busy the background threads are. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of background threads. */
+#define BG_CNT 4
+
+/* Number of periods each deadline thread runs for. */
+#define JOB_CNT 50
+
+struct dl_info
+  {
+    const char *name;
+    int64_t runtime, period, deadline;
+    int missed;
+    struct semaphore *done;
+  };
+
+static thread_func dl_thread;
+static thread_func bg_thread;
+static volatile bool bg_stop;
+
+void
+test_deadline_load (void)
+{
+  struct dl_info info[] =
+    {
+      {"dl fast", 3, 10, 10, 0, NULL},
+      {"dl slow", 4, 20, 15, 0, NULL},
+    };
+  const int dl_cnt = sizeof info / sizeof *info;
+  struct semaphore dl_done, bg_done;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Stay runnable alongside the background threads. */
+  thread_set_priority (PRI_MAX);
+
+  sema_init (&bg_done, 0);
+  bg_stop = false;
+  for (i = 0; i < BG_CNT; i++)
+    thread_create ("background", PRI_MAX, bg_thread, &bg_done);
+
+  sema_init (&dl_done, 0);
+  for (i = 0; i < dl_cnt; i++)
+    {
+      info[i].done = &dl_done;
+      if (thread_create_deadline (info[i].name, info[i].runtime,
+                                  info[i].period, info[i].deadline,
+                                  dl_thread, &info[i]) == TID_ERROR)
+        fail ("could not create deadline thread %s", info[i].name);
+    }
+
+  for (i = 0; i < dl_cnt; i++)
+    sema_down (&dl_done);
+  bg_stop = true;
+  for (i = 0; i < BG_CNT; i++)
+    sema_down (&bg_done);
+
+  for (i = 0; i < dl_cnt; i++)
+    {
+      msg ("%s missed %d of %d deadlines.",
+           info[i].name, info[i].missed, JOB_CNT);
+      if (info[i].missed != 0)
+        fail ("%s missed deadlines under background load", info[i].name);
+    }
+
+  thread_set_priority (PRI_DEFAULT);
+  pass ();
+}
+
+/* Runs JOB_CNT periods of RUNTIME - 1 ticks of work each,
+   counting missed deadlines. */
+static void
+dl_thread (void *info_)
+{
+  struct dl_info *info = info_;
+  int i;
+
+  for (i = 0; i < JOB_CNT; i++)
+    {
+      int64_t last_time = timer_ticks ();
+      int work = 0;
+
+      while (work < info->runtime - 1)
+        {
+          int64_t cur_time = timer_ticks ();
+          if (cur_time != last_time)
+            work++;
+          last_time = cur_time;
+        }
+      if (!thread_deadline_yield ())
+        info->missed++;
+    }
+  sema_up (info->done);
+}
+
+static void
+bg_thread (void *bg_done_)
+{
+  struct semaphore *bg_done = bg_done_;
+
+  while (!bg_stop)
+    continue;
+  sema_up (bg_done);
+}
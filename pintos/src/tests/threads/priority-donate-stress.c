@@ -0,0 +1,135 @@
+/* Stresses priority donation with many locks and many donors.
+
+   The main thread, at PRI_MIN, acquires LOCK_CNT locks, then
+   creates WAITER_CNT threads at assorted higher priorities, each
+   of which blocks on one of the locks and so donates its
+   priority to the main thread.  The main thread then releases
+   the locks one at a time in a scrambled order.  Throughout, its
+   priority must equal that of the highest-priority thread still
+   waiting for a lock that it holds.
+
+   The whole cycle is repeated ROUND_CNT times, and the time it
+   takes is reported, as a benchmark for the cost of donation
+   bookkeeping. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define LOCK_CNT 16
+#define WAITER_CNT 64
+#define ROUND_CNT 20
+
+static struct lock locks[LOCK_CNT];
+static struct semaphore done;
+
+static thread_func waiter;
+static int waiter_priority (int i);
+static int expected_priority (const bool held[], int waiter_cnt);
+static void check_priority (const bool held[], int waiter_cnt);
+
+void
+test_priority_donate_stress (void) 
+{
+  int64_t start;
+  int round, i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  thread_set_priority (PRI_MIN);
+  for (i = 0; i < LOCK_CNT; i++)
+    lock_init (&locks[i]);
+  sema_init (&done, 0);
+
+  start = timer_ticks ();
+  for (round = 0; round < ROUND_CNT; round++) 
+    {
+      bool held[LOCK_CNT];
+
+      for (i = 0; i < LOCK_CNT; i++)
+        {
+          lock_acquire (&locks[i]);
+          held[i] = true;
+        }
+
+      /* Each waiter preempts us and blocks right away. */
+      for (i = 0; i < WAITER_CNT; i++)
+        {
+          char name[16];
+
+          snprintf (name, sizeof name, "waiter %d", i);
+          thread_create (name, waiter_priority (i), waiter, (void *) i);
+          check_priority (held, i + 1);
+        }
+
+      /* Release in a scrambled order.  7 is relatively prime to
+         LOCK_CNT, so this visits every lock once. */
+      for (i = 0; i < LOCK_CNT; i++) 
+        {
+          int j = i * 7 % LOCK_CNT;
+
+          held[j] = false;
+          lock_release (&locks[j]);
+          check_priority (held, WAITER_CNT);
+        }
+
+      for (i = 0; i < WAITER_CNT; i++)
+        sema_down (&done);
+      if (thread_get_priority () != PRI_MIN)
+        fail ("priority %d after round %d", thread_get_priority (), round);
+    }
+
+  msg ("%d rounds of %d donors to %d locks took %"PRId64" ticks",
+       ROUND_CNT, WAITER_CNT, LOCK_CNT, timer_elapsed (start));
+  pass ();
+}
+
+/* Waiter I's priority, between PRI_MIN + 1 and PRI_MAX - 1. */
+static int
+waiter_priority (int i) 
+{
+  return PRI_MIN + 1 + i * 37 % (PRI_MAX - PRI_MIN - 1);
+}
+
+/* Returns the priority that the main thread should have while
+   it holds the locks for which HELD[] is true, once it has
+   created WAITER_CNT waiters. */
+static int
+expected_priority (const bool held[], int waiter_cnt) 
+{
+  int priority = PRI_MIN;
+  int i;
+
+  for (i = 0; i < waiter_cnt; i++)
+    if (held[i % LOCK_CNT] && waiter_priority (i) > priority)
+      priority = waiter_priority (i);
+  return priority;
+}
+
+/* Fails unless the main thread's priority is what it should be
+   while it holds the locks for which HELD[] is true, once it has
+   created WAITER_CNT waiters. */
+static void
+check_priority (const bool held[], int waiter_cnt) 
+{
+  int expected = expected_priority (held, waiter_cnt);
+
+  if (thread_get_priority () != expected)
+    fail ("priority %d, but should be %d", thread_get_priority (), expected);
+}
+
+static void
+waiter (void *i_) 
+{
+  int i = (int) i_;
+  struct lock *lock = &locks[i % LOCK_CNT];
+
+  lock_acquire (lock);
+  lock_release (lock);
+  sema_up (&done);
+}
@@ -0,0 +1,154 @@
+/* Checks that waking up the highest-priority waiter on a
+   semaphore does not get slower as waiters pile up.
+
+   For each waiter count N, creates N threads at assorted
+   priorities below the main thread's, lets them all block on a
+   semaphore, and times N calls to sema_up() with timer_ns().
+   Finally, wakes up MAX_WAITERS waiters one at a time from a
+   lower priority, so that each runs as soon as it is woken, and
+   checks that they woke up in order of priority.
+
+   The test fails if a sema_up() with 200 waiters costs more than
+   four times as much as with 10.  The bound leaves room for the
+   logarithmic cost of a priority queue, but not for sorting all
+   the waiters on every wakeup. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Main thread's priority while it calls sema_up(). */
+#define MAIN_PRI PRI_DEFAULT
+
+/* Number of times to repeat each measurement. */
+#define ROUND_CNT 10
+
+#define MAX_WAITERS 200
+
+static struct semaphore sema;
+static int wake_order[MAX_WAITERS];
+static int wake_cnt;
+
+static thread_func waiter;
+static void create_waiters (int waiter_cnt);
+static int64_t measure (int waiter_cnt);
+static void check_order (int waiter_cnt);
+
+void
+test_priority_sema_scale (void) 
+{
+  static const int sizes[] = {10, 50, MAX_WAITERS};
+  const int size_cnt = sizeof sizes / sizeof *sizes;
+  int64_t per_up[sizeof sizes / sizeof *sizes];
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  thread_set_priority (MAIN_PRI);
+  sema_init (&sema, 0);
+
+  for (i = 0; i < size_cnt; i++)
+    {
+      int64_t total = 0;
+      int round;
+
+      for (round = 0; round < ROUND_CNT; round++)
+        total += measure (sizes[i]);
+      per_up[i] = total / ROUND_CNT / sizes[i];
+      msg ("%3d waiters: %"PRId64" ns per sema_up()", sizes[i], per_up[i]);
+    }
+
+  /* Allow a microsecond of measurement error on top of the 4x
+     bound. */
+  for (i = 1; i < size_cnt; i++)
+    if (per_up[i] > 4 * per_up[0] + 1000)
+      fail ("sema_up() with %d waiters took %"PRId64" ns, "
+            "more than four times as long as with %d (%"PRId64" ns)",
+            sizes[i], per_up[i], sizes[0], per_up[0]);
+
+  check_order (MAX_WAITERS);
+  pass ();
+}
+
+/* Creates WAITER_CNT threads at assorted priorities below
+   MAIN_PRI and lets them all block on the semaphore. */
+static void
+create_waiters (int waiter_cnt) 
+{
+  int i;
+
+  for (i = 0; i < waiter_cnt; i++)
+    {
+      char name[24];
+      int priority = PRI_MIN + 1 + i * 7 % (MAIN_PRI - PRI_MIN - 1);
+
+      snprintf (name, sizeof name, "waiter %d", i);
+      if (thread_create (name, priority, waiter, NULL) == TID_ERROR)
+        fail ("could not create waiter %d", i);
+    }
+
+  /* Dropping our priority lets every waiter run and block. */
+  thread_set_priority (PRI_MIN);
+  thread_set_priority (MAIN_PRI);
+  wake_cnt = 0;
+}
+
+/* Blocks WAITER_CNT threads on the semaphore, wakes them all up,
+   and returns the number of nanoseconds that the sema_up() calls
+   took.  The waiters have lower priorities than ours, so none of
+   them runs until we are done. */
+static int64_t
+measure (int waiter_cnt) 
+{
+  int64_t start, elapsed;
+  int i;
+
+  create_waiters (waiter_cnt);
+
+  start = timer_ns ();
+  for (i = 0; i < waiter_cnt; i++)
+    sema_up (&sema);
+  elapsed = timer_ns () - start;
+
+  /* Let them run and exit. */
+  thread_set_priority (PRI_MIN);
+  thread_set_priority (MAIN_PRI);
+
+  return elapsed;
+}
+
+/* Blocks WAITER_CNT threads on the semaphore and wakes them up
+   from PRI_MIN, so that each one preempts us as soon as it is
+   woken, then checks that they woke up in order of priority. */
+static void
+check_order (int waiter_cnt) 
+{
+  int i;
+
+  create_waiters (waiter_cnt);
+
+  thread_set_priority (PRI_MIN);
+  for (i = 0; i < waiter_cnt; i++)
+    sema_up (&sema);
+  thread_set_priority (MAIN_PRI);
+
+  if (wake_cnt != waiter_cnt)
+    fail ("%d of %d waiters ran", wake_cnt, waiter_cnt);
+  for (i = 1; i < waiter_cnt; i++)
+    if (wake_order[i] > wake_order[i - 1])
+      fail ("waiter with priority %d woke up after one with priority %d",
+            wake_order[i], wake_order[i - 1]);
+  msg ("%d waiters woke up in order of priority", waiter_cnt);
+}
+
+static void
+waiter (void *aux UNUSED) 
+{
+  sema_down (&sema);
+  wake_order[wake_cnt++] = thread_get_priority ();
+}
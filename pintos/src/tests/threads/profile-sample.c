@@ -0,0 +1,35 @@
+/* Spins in a function of its own for a while with profiling
+   enabled, so that the profile dumped at shutdown can be
+   checked.  The check script makes sure the kernel printed a
+   well-formed histogram with samples in it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/profile.h"
+#include "devices/timer.h"
+
+/* Number of timer ticks to spin for. */
+#define SPIN_TICKS 50
+
+static void spin (int64_t ticks);
+
+void
+test_profile_sample (void)
+{
+  if (!profile_enabled)
+    fail ("profiling is not enabled (boot with -profile)");
+
+  spin (SPIN_TICKS);
+  pass ();
+}
+
+/* Busy-waits for TICKS timer ticks. */
+static void NO_INLINE
+spin (int64_t ticks)
+{
+  int64_t start = timer_ticks ();
+
+  while (timer_elapsed (start) < ticks)
+    continue;
+}
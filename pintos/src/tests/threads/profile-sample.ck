@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my (@core) = get_core_output ("run", @output);
+fail "missing PASS in output"
+  unless grep ($_ eq '(profile-sample) PASS', @core);
+
+# The histogram is printed at shutdown, after the test's own
+# output.  The test spins for 50 ticks, so there must be at least
+# that many samples.
+my ($header) = grep (/^Profile: \d+ samples/, @output);
+fail "missing profile header in output" unless defined $header;
+my ($samples) = $header =~ /^Profile: (\d+) samples/;
+fail "only $samples samples in profile" if $samples < 50;
+fail "missing \"Profile: end\" in output"
+  unless grep ($_ eq 'Profile: end', @output);
+fail "no kernel samples in profile"
+  unless grep (/^Profile: kernel 0x[0-9a-f]{8} \d+$/, @output);
+
+pass;
@@ -0,0 +1,121 @@
+/* Measures the cost of a context switch as the number of
+   runnable threads grows.
+
+   For each run queue size N, creates N - 2 filler threads at
+   PRI_DEFAULT.  They stay runnable for the whole measurement but
+   never get the CPU, because the main thread and a partner
+   thread at a higher priority ping-pong between each other with
+   thread_yield().  Every yield therefore inserts into and picks
+   from a run queue that holds N threads.
+
+   With an O(1) run queue the time per switch should not depend
+   on N, so the test fails if switching with 1000 runnable
+   threads takes more than twice as long as with 2.  The kernel
+   needs extra memory for the thread pages, so this test runs
+   with -m 16. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of yields by each of the two ping-pong threads. */
+#define YIELD_CNT 20000
+
+/* Priority of the ping-pong threads. */
+#define PING_PRI (PRI_DEFAULT + 2)
+
+static thread_func partner_thread;
+static thread_func filler_thread;
+static int64_t measure (int thread_cnt);
+
+void
+test_sched_switch_cost (void)
+{
+  static const int sizes[] = {2, 10, 100, 1000};
+  const int size_cnt = sizeof sizes / sizeof *sizes;
+  int64_t elapsed[sizeof sizes / sizeof *sizes];
+  int64_t fastest;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  thread_set_priority (PING_PRI);
+
+  for (i = 0; i < size_cnt; i++)
+    {
+      elapsed[i] = measure (sizes[i]);
+      msg ("%4d runnable threads: %"PRId64" ticks for %d switches",
+           sizes[i], elapsed[i], 2 * YIELD_CNT);
+    }
+
+  fastest = elapsed[0];
+  for (i = 1; i < size_cnt; i++)
+    if (elapsed[i] < fastest)
+      fastest = elapsed[i];
+
+  /* Allow one tick of measurement error on top of the 2x bound. */
+  for (i = 0; i < size_cnt; i++)
+    if (elapsed[i] > 2 * fastest + 1)
+      fail ("switching with %d runnable threads took %"PRId64" ticks, "
+            "more than twice the fastest run (%"PRId64" ticks)",
+            sizes[i], elapsed[i], fastest);
+
+  thread_set_priority (PRI_DEFAULT);
+  pass ();
+}
+
+/* Runs the ping-pong measurement with THREAD_CNT runnable
+   threads and returns the number of timer ticks it took. */
+static int64_t
+measure (int thread_cnt)
+{
+  struct semaphore fillers_done;
+  int64_t start, elapsed;
+  int i;
+
+  sema_init (&fillers_done, 0);
+  for (i = 0; i < thread_cnt - 2; i++)
+    if (thread_create ("filler", PRI_DEFAULT, filler_thread,
+                       &fillers_done) == TID_ERROR)
+      fail ("could not create filler thread %d", i);
+
+  /* Start on a tick boundary.  Spin rather than sleep, so that
+     the fillers do not get to run. */
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    continue;
+  thread_create ("partner", PING_PRI, partner_thread, NULL);
+
+  start = timer_ticks ();
+  for (i = 0; i < YIELD_CNT; i++)
+    thread_yield ();
+  elapsed = timer_elapsed (start);
+
+  /* Blocking lets the fillers run and exit. */
+  for (i = 0; i < thread_cnt - 2; i++)
+    sema_down (&fillers_done);
+
+  return elapsed;
+}
+
+static void
+partner_thread (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < YIELD_CNT; i++)
+    thread_yield ();
+}
+
+static void
+filler_thread (void *fillers_done_)
+{
+  struct semaphore *fillers_done = fillers_done_;
+
+  sema_up (fillers_done);
+}
@@ -0,0 +1,58 @@
+/* Generates scheduler events with tracing enabled, so that the
+   trace dumped at shutdown can be checked.
+
+   Two threads pass control back and forth through a pair of
+   semaphores ROUND_CNT times, which records a block, a wakeup,
+   and a switch each way per round, while the timer interrupt
+   records interrupt entries and exits.  The check script makes
+   sure the kernel dumped a trace to the console. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/trace.h"
+
+/* Number of round trips between the two threads. */
+#define ROUND_CNT 100
+
+struct ping_pong
+  {
+    struct semaphore ping, pong;
+  };
+
+static thread_func pong_thread;
+
+void
+test_sched_trace (void)
+{
+  struct ping_pong pp;
+  int i;
+
+  if (!trace_enabled)
+    fail ("tracing is not enabled (boot with -trace)");
+
+  sema_init (&pp.ping, 0);
+  sema_init (&pp.pong, 0);
+  thread_create ("pong", PRI_DEFAULT, pong_thread, &pp);
+  for (i = 0; i < ROUND_CNT; i++)
+    {
+      sema_up (&pp.ping);
+      sema_down (&pp.pong);
+    }
+  pass ();
+}
+
+static void
+pong_thread (void *pp_)
+{
+  struct ping_pong *pp = pp_;
+  int i;
+
+  for (i = 0; i < ROUND_CNT; i++)
+    {
+      sema_down (&pp->ping);
+      sema_up (&pp->pong);
+    }
+}
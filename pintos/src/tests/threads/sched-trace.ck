@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my (@core) = get_core_output ("run", @output);
+fail "missing PASS in output"
+  unless grep ($_ eq '(sched-trace) PASS', @core);
+
+# The trace is dumped at shutdown, after the test's own output.
+my ($begin) = grep ($output[$_] eq 'Trace: begin', 0...$#output);
+my ($end) = grep ($output[$_] eq 'Trace: end', 0...$#output);
+fail "missing \"Trace: begin\" in output" unless defined $begin;
+fail "missing \"Trace: end\" in output" unless defined $end && $end > $begin;
+fail "trace does not start with header"
+  unless $output[$begin + 1] =~ /^Trace: 50545243/;
+fail "bad trace line \"$_\""
+  foreach grep (!/^Trace: [0-9a-f]+$/, @output[$begin + 1...$end - 1]);
+
+pass;
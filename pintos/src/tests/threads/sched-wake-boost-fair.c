@@ -0,0 +1,115 @@
+/* Checks that two threads that keep waking each other up cannot
+   use the wakeup boost to shut out a CPU-bound thread at the same
+   priority.
+
+   A "ping" and a "pong" thread pass the CPU back and forth
+   through a pair of semaphores, so each of them blocks, and is
+   boosted, every time around.  Once they are going, ping creates
+   a spinner at the same priority, which goes to the back of the
+   ordinary run queue.  The spinner has to get the CPU within
+   TIMEOUT_SECS while the ping-pong carries on. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of round trips before the spinner is created. */
+#define WARMUP_CNT 10
+
+/* How long the spinner may be kept waiting. */
+#define TIMEOUT_SECS 5
+
+static thread_func ping_thread;
+static thread_func pong_thread;
+static thread_func spinner_thread;
+
+static struct semaphore ping, pong, done;
+static volatile bool stop;
+static volatile unsigned spins;
+static bool timed_out;
+
+void
+test_sched_wake_boost_fair (void)
+{
+  int i;
+
+  /* This test does not work with the MLFQS or stride scheduler. */
+  ASSERT (!thread_mlfqs);
+  ASSERT (!thread_stride);
+
+  sema_init (&ping, 0);
+  sema_init (&pong, 0);
+  sema_init (&done, 0);
+  stop = false;
+  spins = 0;
+  timed_out = false;
+
+  thread_create ("ping", PRI_DEFAULT, ping_thread, NULL);
+  thread_create ("pong", PRI_DEFAULT, pong_thread, NULL);
+  for (i = 0; i < 3; i++)
+    sema_down (&done);
+
+  if (timed_out)
+    fail ("spinner did not run within %d seconds", TIMEOUT_SECS);
+  msg ("spinner ran during the ping-pong");
+  pass ();
+}
+
+/* Plays ping-pong with pong_thread until the spinner has run or
+   time is up, then stops everything. */
+static void
+ping_thread (void *aux UNUSED)
+{
+  int64_t start = 0;
+  int i;
+
+  for (i = 0; ; i++)
+    {
+      if (i == WARMUP_CNT)
+        {
+          start = timer_ticks ();
+          thread_create ("spinner", PRI_DEFAULT, spinner_thread, NULL);
+        }
+      else if (i > WARMUP_CNT)
+        {
+          if (spins > 0)
+            break;
+          if (timer_elapsed (start) >= TIMEOUT_SECS * TIMER_FREQ)
+            {
+              timed_out = true;
+              break;
+            }
+        }
+
+      sema_up (&pong);
+      sema_down (&ping);
+    }
+
+  stop = true;
+  sema_up (&pong);
+  sema_up (&done);
+}
+
+static void
+pong_thread (void *aux UNUSED)
+{
+  for (;;)
+    {
+      sema_down (&pong);
+      if (stop)
+        break;
+      sema_up (&ping);
+    }
+  sema_up (&done);
+}
+
+static void
+spinner_thread (void *aux UNUSED)
+{
+  while (!stop)
+    spins++;
+  sema_up (&done);
+}
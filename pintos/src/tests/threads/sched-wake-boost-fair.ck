@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sched-wake-boost-fair) begin
+(sched-wake-boost-fair) spinner ran during the ping-pong
+(sched-wake-boost-fair) PASS
+(sched-wake-boost-fair) end
+EOF
+pass;
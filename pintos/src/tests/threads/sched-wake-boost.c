@@ -0,0 +1,88 @@
+/* Checks that a thread that keeps sleeping gets the CPU back
+   soon after it wakes up, even though CPU-bound threads at the
+   same priority are waiting for it too.
+
+   Starts HOG_CNT threads that spin at the main thread's
+   priority, whose time slices grow as they use them up, and one
+   more thread at the same priority that sleeps for 1 tick
+   SLEEP_CNT times.  A woken thread runs ahead of the other ready
+   threads at its priority, so it should have to wait at most
+   for the rest of one hog's time slice, never for every hog's
+   slice in turn. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of CPU-bound threads. */
+#define HOG_CNT 4
+
+/* Number of times the sleeping thread sleeps. */
+#define SLEEP_CNT 50
+
+static thread_func sleeper_thread;
+static thread_func hog_thread;
+static volatile bool hog_stop;
+static int64_t max_latency;
+
+void
+test_sched_wake_boost (void)
+{
+  struct semaphore done;
+  int i;
+
+  /* This test does not work with the MLFQS or stride scheduler. */
+  ASSERT (!thread_mlfqs);
+  ASSERT (!thread_stride);
+
+  sema_init (&done, 0);
+  hog_stop = false;
+  for (i = 0; i < HOG_CNT; i++)
+    thread_create ("hog", PRI_DEFAULT, hog_thread, &done);
+  thread_create ("sleeper", PRI_DEFAULT, sleeper_thread, &done);
+
+  for (i = 0; i < HOG_CNT + 1; i++)
+    sema_down (&done);
+
+  msg ("longest wait after waking: %"PRId64" ticks", max_latency);
+  if (max_latency > thread_slice_max)
+    fail ("woken thread waited longer than one time slice");
+  pass ();
+}
+
+/* Sleeps SLEEP_CNT times, recording the longest time it took to
+   run again after each wakeup, then stops the hogs. */
+static void
+sleeper_thread (void *done_)
+{
+  struct semaphore *done = done_;
+  int i;
+
+  max_latency = 0;
+  for (i = 0; i < SLEEP_CNT; i++)
+    {
+      int64_t start = timer_ticks ();
+      int64_t latency;
+
+      timer_sleep (1);
+      latency = timer_elapsed (start) - 1;
+      if (latency > max_latency)
+        max_latency = latency;
+    }
+  hog_stop = true;
+  sema_up (done);
+}
+
+static void
+hog_thread (void *done_)
+{
+  struct semaphore *done = done_;
+
+  while (!hog_stop)
+    continue;
+  sema_up (done);
+}
@@ -0,0 +1,108 @@
+/* Checks that threads run on every CPU at once, and that turning
+   interrupts off still keeps them out of each other's way.
+
+   Run with --smp=4.  One spinner thread per CPU repeatedly
+   increments a shared counter with interrupts off, in separate
+   read and write steps that would lose increments if two CPUs
+   interleaved them, and notes which CPU it is on.  The spinners
+   never block, so each one has to find a CPU of its own before
+   all of them can have run.  Once a spinner has done its
+   increments, it keeps its CPU until every CPU has run a spinner
+   or TIMEOUT_SECS pass. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/smp.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Increments done by each spinner. */
+#define INCR_CNT 100000
+
+/* How long to wait for every CPU to run a spinner. */
+#define TIMEOUT_SECS 5
+
+static thread_func spinner_thread;
+
+static struct semaphore done;
+static volatile int counter;
+static volatile unsigned cpus_seen;     /* Bit i set: CPU i ran a spinner. */
+static int64_t start;
+
+static int count_bits (unsigned);
+
+void
+test_smp_parallel (void)
+{
+  int cpu_cnt = smp_cpu_cnt ();
+  int i;
+
+  /* This test does not work with the MLFQS or stride scheduler. */
+  ASSERT (!thread_mlfqs);
+  ASSERT (!thread_stride);
+
+  if (cpu_cnt < 2)
+    fail ("only %d CPU running", cpu_cnt);
+  msg ("%d CPUs running", cpu_cnt);
+
+  sema_init (&done, 0);
+  counter = 0;
+  cpus_seen = 0;
+  start = timer_ticks ();
+  for (i = 0; i < cpu_cnt; i++)
+    thread_create ("spinner", PRI_DEFAULT, spinner_thread, NULL);
+  for (i = 0; i < cpu_cnt; i++)
+    sema_down (&done);
+
+  if (count_bits (cpus_seen) != cpu_cnt)
+    fail ("only %d of %d CPUs ran a spinner within %d seconds",
+          count_bits (cpus_seen), cpu_cnt, TIMEOUT_SECS);
+  msg ("every CPU ran a spinner");
+
+  if (counter != cpu_cnt * INCR_CNT)
+    fail ("counter is %d, should be %d", counter, cpu_cnt * INCR_CNT);
+  msg ("no increments lost");
+  pass ();
+}
+
+static void
+spinner_thread (void *aux UNUSED)
+{
+  int cpu_cnt = smp_cpu_cnt ();
+  int i;
+
+  for (i = 0; i < INCR_CNT; i++)
+    {
+      enum intr_level old_level = intr_disable ();
+      int value = counter;
+      cpus_seen |= 1u << smp_cpu_id ();
+      counter = value + 1;
+      intr_set_level (old_level);
+    }
+
+  for (;;)
+    {
+      enum intr_level old_level = intr_disable ();
+      bool all_seen;
+      cpus_seen |= 1u << smp_cpu_id ();
+      all_seen = count_bits (cpus_seen) == cpu_cnt;
+      intr_set_level (old_level);
+
+      if (all_seen || timer_elapsed (start) >= TIMEOUT_SECS * TIMER_FREQ)
+        break;
+    }
+  sema_up (&done);
+}
+
+/* Returns the number of bits set in X. */
+static int
+count_bits (unsigned x)
+{
+  int cnt = 0;
+  for (; x != 0; x &= x - 1)
+    cnt++;
+  return cnt;
+}
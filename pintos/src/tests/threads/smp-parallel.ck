@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(smp-parallel) begin
+(smp-parallel) 4 CPUs running
+(smp-parallel) every CPU ran a spinner
+(smp-parallel) no increments lost
+(smp-parallel) PASS
+(smp-parallel) end
+EOF
+pass;
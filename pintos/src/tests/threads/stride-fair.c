@@ -0,0 +1,109 @@
+/* Checks that the stride scheduler divides the CPU in
+   proportion to tickets.
+
+   Starts three threads with 100, 200, and 300 tickets that spin
+   together for 10,000 ticks, counting the ticks they get.  Each
+   thread should receive its share of the ticks handed out, that
+   is, 1/6, 2/6, and 3/6 of them.  The test fails if any thread's
+   count is off from its share by more than 1% of the total.
+
+   A stride scheduler's error does not grow with the length of
+   the run, so this bound is loose; a round-robin scheduler,
+   which would give each thread a third, misses it by a wide
+   margin.  This test must be run with -stride. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of ticks the threads spin for. */
+#define TEST_TICKS 10000
+
+/* Largest allowed error, in hundredths of the total ticks. */
+#define SHARE_ERROR_PCT 1
+
+#define THREAD_CNT 3
+
+struct thread_info
+  {
+    int64_t start_time;
+    int tickets;
+    int tick_count;
+  };
+
+static thread_func load_thread;
+
+void
+test_stride_fair (void)
+{
+  struct thread_info info[THREAD_CNT];
+  int64_t start_time;
+  int total_tickets = 0;
+  int total_ticks = 0;
+  int i;
+
+  ASSERT (thread_stride);
+
+  start_time = timer_ticks ();
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      struct thread_info *ti = &info[i];
+      char name[16];
+
+      ti->start_time = start_time;
+      ti->tickets = (i + 1) * TICKETS_DEFAULT;
+      ti->tick_count = 0;
+      total_tickets += ti->tickets;
+
+      snprintf (name, sizeof name, "load %d", i);
+      thread_create (name, PRI_DEFAULT, load_thread, ti);
+    }
+
+  msg ("Sleeping %d ticks to let threads run, please wait...",
+       TEST_TICKS);
+  timer_sleep (TEST_TICKS + 2 * TIMER_FREQ);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    total_ticks += info[i].tick_count;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      int expected = total_ticks * info[i].tickets / total_tickets;
+      int error = info[i].tick_count - expected;
+
+      msg ("Thread %d with %d tickets received %d ticks, expected %d.",
+           i, info[i].tickets, info[i].tick_count, expected);
+      if (error < 0)
+        error = -error;
+      if (error * 100 > total_ticks * SHARE_ERROR_PCT)
+        fail ("thread %d is off from its share by %d of %d ticks",
+              i, error, total_ticks);
+    }
+  pass ();
+}
+
+/* Sets its tickets, waits for the other threads to start, and
+   then spins for TEST_TICKS ticks, counting the ticks in which
+   it ran. */
+static void
+load_thread (void *ti_)
+{
+  struct thread_info *ti = ti_;
+  int64_t sleep_time = TIMER_FREQ;
+  int64_t spin_time = sleep_time + TEST_TICKS;
+  int64_t last_time = 0;
+
+  thread_set_tickets (ti->tickets);
+  timer_sleep (sleep_time - timer_elapsed (ti->start_time));
+  while (timer_elapsed (ti->start_time) < spin_time)
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        ti->tick_count++;
+      last_time = cur_time;
+    }
+}
@@ -17,6 +17,8 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-cancel", test_alarm_cancel},
+    {"alarm-hires", test_alarm_hires},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -25,9 +27,11 @@ static const struct test tests[] =
     {"priority-donate-sema", test_priority_donate_sema},
     {"priority-donate-lower", test_priority_donate_lower},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"priority-donate-stress", test_priority_donate_stress},
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
+    {"priority-sema-scale", test_priority_sema_scale},
     {"priority-condvar", test_priority_condvar},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
@@ -38,6 +42,17 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"sched-switch-cost", test_sched_switch_cost},
+    {"stride-fair", test_stride_fair},
+    {"deadline-admit", test_deadline_admit},
+    {"deadline-load", test_deadline_load},
+    {"thread-create-cost", test_thread_create_cost},
+    {"sched-wake-boost", test_sched_wake_boost},
+    {"sched-wake-boost-fair", test_sched_wake_boost_fair},
+    {"sched-trace", test_sched_trace},
+    {"profile-sample", test_profile_sample},
+    {"workqueue-run", test_workqueue_run},
+    {"smp-parallel", test_smp_parallel},
   };
 
 static const char *test_name;
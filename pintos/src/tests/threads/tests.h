@@ -11,6 +11,8 @@ extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_priority;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_alarm_cancel;
+extern test_func test_alarm_hires;
 extern test_func test_priority_change;
 extern test_func test_priority_donate_one;
 extern test_func test_priority_donate_multiple;
@@ -19,9 +21,11 @@ extern test_func test_priority_donate_sema;
 extern test_func test_priority_donate_nest;
 extern test_func test_priority_donate_lower;
 extern test_func test_priority_donate_chain;
+extern test_func test_priority_donate_stress;
 extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
+extern test_func test_priority_sema_scale;
 extern test_func test_priority_condvar;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
@@ -32,6 +36,17 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_sched_switch_cost;
+extern test_func test_stride_fair;
+extern test_func test_deadline_admit;
+extern test_func test_deadline_load;
+extern test_func test_thread_create_cost;
+extern test_func test_sched_wake_boost;
+extern test_func test_sched_wake_boost_fair;
+extern test_func test_sched_trace;
+extern test_func test_profile_sample;
+extern test_func test_workqueue_run;
+extern test_func test_smp_parallel;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,96 @@
+/* Measures the cost of creating a thread that exits at once,
+   with and without the cache of exited threads' pages.
+
+   Each round creates a thread at a higher priority than the main
+   thread, so it runs and exits before thread_create() returns,
+   and its page is freed, or cached, as soon as the main thread
+   runs again.  Without the cache, every round takes a page from
+   the page allocator and gives it back.  With it, every round
+   after the first reuses the same page.
+
+   Reports the median time per thread both ways, over several
+   samples.  The timings are for information only, since they
+   are too noisy under an emulator to compare.  The test fails if
+   the cache is used while it is disabled, or if it does not
+   supply the page for every round but the first while it is
+   enabled. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of threads created in each sample. */
+#define ROUND_CNT 500
+
+/* Number of samples taken each way. */
+#define SAMPLE_CNT 5
+
+static thread_func exit_thread;
+static int64_t measure (unsigned *hits);
+
+void
+test_thread_create_cost (void)
+{
+  unsigned saved_limit = thread_cache_limit;
+  unsigned hits;
+  int64_t uncached, cached;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  thread_cache_limit = 0;
+  thread_cache_reclaim ();
+  uncached = measure (&hits);
+  msg ("without cache: %"PRId64" ns per thread", uncached / ROUND_CNT);
+  if (hits != 0)
+    fail ("%u pages reused with the cache disabled", hits);
+
+  thread_cache_limit = saved_limit > 0 ? saved_limit : 1;
+  cached = measure (&hits);
+  msg ("with cache: %"PRId64" ns per thread", cached / ROUND_CNT);
+  if (hits < SAMPLE_CNT * ROUND_CNT - 1)
+    fail ("only %u of %d pages reused with the cache enabled",
+          hits, SAMPLE_CNT * ROUND_CNT);
+
+  thread_cache_limit = saved_limit;
+  pass ();
+}
+
+/* Takes SAMPLE_CNT samples, each the time in nanoseconds to
+   create and reap ROUND_CNT threads, and returns the median.
+   Stores into *HITS the number of thread pages that came from
+   the cache meanwhile. */
+static int64_t
+measure (unsigned *hits)
+{
+  int64_t samples[SAMPLE_CNT];
+  unsigned start_hits = thread_cache_hit_cnt ();
+  int i, j;
+
+  for (i = 0; i < SAMPLE_CNT; i++)
+    {
+      int64_t start = timer_ns ();
+      int64_t elapsed;
+
+      for (j = 0; j < ROUND_CNT; j++)
+        if (thread_create ("exit", PRI_DEFAULT + 1, exit_thread, NULL)
+            == TID_ERROR)
+          fail ("could not create thread %d", j);
+      elapsed = timer_ns () - start;
+
+      /* Insertion sort. */
+      for (j = i; j > 0 && samples[j - 1] > elapsed; j--)
+        samples[j] = samples[j - 1];
+      samples[j] = elapsed;
+    }
+  *hits = thread_cache_hit_cnt () - start_hits;
+  return samples[SAMPLE_CNT / 2];
+}
+
+static void
+exit_thread (void *aux UNUSED)
+{
+}
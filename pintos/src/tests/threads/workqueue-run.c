@@ -0,0 +1,63 @@
+/* Checks that work queued on a work queue runs once per time it
+   is queued, in the work queue's own thread, at the work queue's
+   priority, and that it may sleep.
+
+   The work queue runs at a lower priority than the main thread,
+   so queuing the same item twice before it has had a chance to
+   run should queue it just once. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+static work_func test_work;
+static struct semaphore done;
+static int run_cnt;
+
+void
+test_workqueue_run (void)
+{
+  struct workqueue *wq;
+  struct work w;
+
+  /* This test does not work with the MLFQS or stride scheduler. */
+  ASSERT (!thread_mlfqs);
+  ASSERT (!thread_stride);
+
+  sema_init (&done, 0);
+  work_init (&w, test_work);
+  wq = workqueue_create ("worker", PRI_DEFAULT - 1);
+  if (wq == NULL)
+    fail ("workqueue_create() failed");
+
+  msg ("queue work: %s", workqueue_queue (wq, &w) ? "true" : "false");
+  msg ("queue work again: %s",
+       workqueue_queue (wq, &w) ? "true" : "false");
+  sema_down (&done);
+
+  msg ("queue work after it ran: %s",
+       workqueue_queue (wq, &w) ? "true" : "false");
+  sema_down (&done);
+
+  msg ("work ran %d times", run_cnt);
+}
+
+/* Reports where it runs, sleeps, and lets the main thread go
+   on. */
+static void
+test_work (struct work *w UNUSED) 
+{
+  struct thread *t = thread_current ();
+
+  run_cnt++;
+  msg ("work ran in thread \"%s\" at priority %d",
+       t->name, thread_get_priority ());
+  timer_sleep (1);
+  msg ("work slept");
+  sema_up (&done);
+}
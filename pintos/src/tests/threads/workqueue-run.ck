@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue-run) begin
+(workqueue-run) queue work: true
+(workqueue-run) queue work again: false
+(workqueue-run) work ran in thread "worker" at priority 30
+(workqueue-run) work slept
+(workqueue-run) queue work after it ran: true
+(workqueue-run) work ran in thread "worker" at priority 30
+(workqueue-run) work slept
+(workqueue-run) work ran 2 times
+(workqueue-run) end
+EOF
+pass;
@@ -0,0 +1,63 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* CPUID leaf 1 feature flags in EDX.
+   See [IA32-v2a] "CPUID". */
+#define CPUID_TSC  (1 << 4)     /* Time stamp counter. */
+#define CPUID_MSR  (1 << 5)     /* RDMSR and WRMSR instructions. */
+#define CPUID_APIC (1 << 9)     /* On-chip local APIC. */
+
+/* Executes CPUID with EAX set to LEAF and returns the
+   resulting EAX, EBX, ECX, EDX in the given pointers. */
+static inline void
+cpuid (uint32_t leaf, uint32_t *eax, uint32_t *ebx,
+       uint32_t *ecx, uint32_t *edx)
+{
+  /* See [IA32-v2a] "CPUID". */
+  asm volatile ("cpuid"
+                : "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx)
+                : "a" (leaf));
+}
+
+/* Returns true if the CPU has all of the CPUID leaf 1 EDX
+   feature flags in FEATURES. */
+static inline bool
+cpu_has (uint32_t features)
+{
+  uint32_t eax, ebx, ecx, edx;
+  cpuid (1, &eax, &ebx, &ecx, &edx);
+  return (edx & features) == features;
+}
+
+/* Reads and returns the time stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  /* See [IA32-v2b] "RDTSC". */
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Reads and returns model-specific register MSR. */
+static inline uint64_t
+rdmsr (uint32_t msr)
+{
+  /* See [IA32-v2b] "RDMSR". */
+  uint64_t value;
+  asm volatile ("rdmsr" : "=A" (value) : "c" (msr));
+  return value;
+}
+
+/* Writes VALUE to model-specific register MSR. */
+static inline void
+wrmsr (uint32_t msr, uint64_t value)
+{
+  /* See [IA32-v2b] "WRMSR". */
+  asm volatile ("wrmsr" : : "c" (msr), "A" (value));
+}
+
+#endif /* threads/cpu.h */
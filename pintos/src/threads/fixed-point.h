@@ -0,0 +1,98 @@
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
+
+#include <stdint.h>
+
+/* Signed 17.14 fixed-point arithmetic, as used by the
+   multi-level feedback queue scheduler to track load_avg and
+   recent_cpu without floating point, which the kernel does not
+   support.
+
+   A fixed_t holds a real number X as the integer X * FP_F, where
+   FP_F = 2**14.  That leaves 17 bits before the binary point,
+   enough for values up to about 131,071.  Products are computed
+   in 64 bits so they do not overflow before being scaled back
+   down. */
+typedef int32_t fixed_t;
+
+/* Scale factor: 1.0 in fixed point. */
+#define FP_F (1 << 14)
+
+/* Converts integer N to fixed point. */
+static inline fixed_t
+fp_from_int (int n)
+{
+  return n * FP_F;
+}
+
+/* Converts fixed-point X to an integer, rounding toward zero. */
+static inline int
+fp_to_int (fixed_t x)
+{
+  return x / FP_F;
+}
+
+/* Converts fixed-point X to an integer, rounding to nearest. */
+static inline int
+fp_to_int_round (fixed_t x)
+{
+  return x >= 0 ? (x + FP_F / 2) / FP_F : (x - FP_F / 2) / FP_F;
+}
+
+/* Returns X + Y. */
+static inline fixed_t
+fp_add (fixed_t x, fixed_t y)
+{
+  return x + y;
+}
+
+/* Returns X - Y. */
+static inline fixed_t
+fp_sub (fixed_t x, fixed_t y)
+{
+  return x - y;
+}
+
+/* Returns X + N, for integer N. */
+static inline fixed_t
+fp_add_int (fixed_t x, int n)
+{
+  return x + n * FP_F;
+}
+
+/* Returns X - N, for integer N. */
+static inline fixed_t
+fp_sub_int (fixed_t x, int n)
+{
+  return x - n * FP_F;
+}
+
+/* Returns X * Y. */
+static inline fixed_t
+fp_mul (fixed_t x, fixed_t y)
+{
+  return ((int64_t) x) * y / FP_F;
+}
+
+/* Returns X * N, for integer N. */
+static inline fixed_t
+fp_mul_int (fixed_t x, int n)
+{
+  return x * n;
+}
+
+/* Returns X / Y. */
+static inline fixed_t
+fp_div (fixed_t x, fixed_t y)
+{
+  return ((int64_t) x) * FP_F / y;
+}
+
+/* Returns X / N, for integer N. */
+static inline fixed_t
+fp_div_int (fixed_t x, int n)
+{
+  return x / n;
+}
+
+#endif /* threads/fixed-point.h */
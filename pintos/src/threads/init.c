@@ -9,19 +9,26 @@
 #include <stdlib.h>
 #include <string.h>
 #include "devices/kbd.h"
+#include "devices/mp.h"
 #include "devices/input.h"
 #include "devices/serial.h"
 #include "devices/shutdown.h"
 #include "devices/timer.h"
+#include "devices/tsc.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/pte.h"
+#include "threads/smp.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -64,6 +71,7 @@ static char **read_command_line (void);
 static char **parse_options (char **argv);
 static void run_actions (char **argv);
 static void usage (void);
+static void print_boot_time (void);
 
 #ifdef FILESYS
 static void locate_block_devices (void);
@@ -72,6 +80,9 @@ static void locate_block_device (enum block_type, const char *name);
 
 int main (void) NO_RETURN;
 
+/* TSC value on entry to main(), if the CPU has a TSC. */
+static uint64_t start_tsc;
+
 /* Pintos main program. */
 int
 main (void)
@@ -81,6 +92,10 @@ main (void)
   /* Clear BSS. */  
   bss_init ();
 
+  /* Note when we started, to report how long booting took. */
+  if (cpu_has (CPUID_TSC))
+    start_tsc = rdtsc ();
+
   /* Break command line into arguments and parse options. */
   argv = read_command_line ();
   argv = parse_options (argv);
@@ -97,7 +112,10 @@ main (void)
   /* Initialize memory system. */
   palloc_init (user_page_limit);
   malloc_init ();
+  trace_init ();
+  profile_init ();
   paging_init ();
+  mp_init ();
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -119,6 +137,7 @@ main (void)
   thread_start ();
   serial_init_queue ();
   timer_calibrate ();
+  smp_start ();
 
 #ifdef FILESYS
   /* Initialize file system. */
@@ -127,7 +146,7 @@ main (void)
   filesys_init (format_filesys);
 #endif
 
-  printf ("Boot complete.\n");
+  print_boot_time ();
   
   /* Run actions specified on kernel command line. */
   run_actions (argv);
@@ -251,11 +270,49 @@ parse_options (char **argv)
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
 #endif
+      else if (!strcmp (name, "-trace-scratch"))
+        trace_to_scratch = true;
 #endif
       else if (!strcmp (name, "-rs"))
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-stride"))
+        thread_stride = true;
+      else if (!strcmp (name, "-donate-depth"))
+        lock_donate_depth = atoi (value);
+      else if (!strcmp (name, "-thread-cache"))
+        thread_cache_limit = atoi (value);
+      else if (!strcmp (name, "-slice-min"))
+        thread_slice_min = atoi (value);
+      else if (!strcmp (name, "-slice-max"))
+        thread_slice_max = atoi (value);
+      else if (!strcmp (name, "-no-wake-boost"))
+        thread_wake_boost = false;
+      else if (!strcmp (name, "-trace"))
+        {
+          trace_pages = value != NULL ? atoi (value) : TRACE_DEFAULT_PAGES;
+          if (trace_pages == 0)
+            PANIC ("-trace requires a positive page count");
+        }
+      else if (!strcmp (name, "-profile"))
+        {
+          profile_pages = (value != NULL ? atoi (value)
+                           : PROFILE_DEFAULT_PAGES);
+          if (profile_pages == 0)
+            PANIC ("-profile requires a positive page count");
+        }
+      else if (!strcmp (name, "-tickless"))
+        timer_tickless = true;
+      else if (!strcmp (name, "-lapic"))
+        timer_lapic = true;
+      else if (!strcmp (name, "-lpt"))
+        {
+          int loops = atoi (value);
+          if (loops <= 0)
+            PANIC ("-lpt requires a positive loop count");
+          timer_set_loops_per_tick (loops);
+        }
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -264,6 +321,9 @@ parse_options (char **argv)
         PANIC ("unknown option `%s' (use -h for help)", name);
     }
 
+  if (thread_mlfqs && thread_stride)
+    PANIC ("-mlfqs and -stride cannot be used together");
+
   /* Initialize the random number generator based on the system
      time.  This has no effect if an "-rs" option was specified.
 
@@ -292,6 +352,22 @@ run_task (char **argv)
   printf ("Execution of '%s' complete.\n", task);
 }
 
+/* Announces that booting is complete, with the time it took
+   from entering main() up to now, just before the first action.
+   Without a TSC, the time is counted from timer_init() instead,
+   which leaves out only the memory system's setup. */
+static void
+print_boot_time (void) 
+{
+  int64_t ns;
+
+  if (tsc_available ())
+    ns = tsc_to_ns (tsc_read () - start_tsc);
+  else
+    ns = timer_ns ();
+  printf ("Boot complete in %'"PRId64" us.\n", ns / 1000);
+}
+
 /* Executes all of the actions specified in ARGV[]
    up to the null pointer sentinel. */
 static void
@@ -376,9 +452,21 @@ usage (void)
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
 #endif
+          "  -trace-scratch     Dump the scheduler trace to the scratch disk.\n"
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -stride            Use stride (proportional-share) scheduler.\n"
+          "  -donate-depth=N    Pass priority donations through N lock holders.\n"
+          "  -thread-cache=N    Keep up to N exited threads' pages for reuse.\n"
+          "  -slice-min=N       Shrink I/O-bound threads' slices to N ticks.\n"
+          "  -slice-max=N       Grow CPU-bound threads' slices to N ticks.\n"
+          "  -no-wake-boost     Do not run woken threads ahead of their peers.\n"
+          "  -trace[=PAGES]     Trace scheduler events in a PAGES-page buffer.\n"
+          "  -profile[=PAGES]   Sample EIP on timer ticks into a PAGES-page table.\n"
+          "  -tickless          Stop the timer tick while the CPU is idle.\n"
+          "  -lapic             Drive the timer tick from the local APIC.\n"
+          "  -lpt=LOOPS         Skip timer calibration, using LOOPS loops/tick.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
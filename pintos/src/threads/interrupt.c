@@ -3,12 +3,19 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
+#include "threads/smp.h"
+#include "threads/spinlock.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/workqueue.h"
 #include "threads/vaddr.h"
+#include "devices/lapic.h"
 #include "devices/timer.h"
+#include "devices/tsc.h"
 
 /* Programmable Interrupt Controller (PIC) registers.
    A PC has two PICs, called the master and slave PICs, with the
@@ -37,15 +44,85 @@ static const char *intr_names[INTR_CNT];
    unexpected interrupt is one that has no registered handler. */
 static unsigned int unexpected_cnt[INTR_CNT];
 
+/* Statistics for each vector, printed by intr_print_stats().
+   Only external interrupt handlers are timed, because other
+   handlers may sleep or be preempted.  Times are in TSC cycles
+   and are not kept if there is no TSC. */
+struct intr_stats
+  {
+    long long cnt;              /* Number of invocations. */
+    uint64_t total_cycles;      /* Total time in the handler. */
+    uint64_t max_cycles;        /* Longest time in the handler. */
+  };
+static struct intr_stats intr_stats[INTR_CNT];
+
+/* The longest time interrupts were kept off between a call to
+   intr_disable() or intr_set_level() and the matching call to
+   intr_enable() or intr_set_level(), and where it started.
+   Interrupt handlers, which run with interrupts off from entry
+   to return, are accounted in intr_stats instead.  Each CPU
+   tracks its own current window in its struct cpu. */
+static uint64_t off_max_cycles; /* Longest window so far. */
+static void *off_max_caller;    /* Who turned them off for it. */
+
 /* External interrupts are those generated by devices outside the
    CPU, such as the timer.  External interrupts run with
    interrupts turned off, so they never nest, nor are they ever
    pre-empted.  Handlers for external interrupts also may not
    sleep, although they may invoke intr_yield_on_return() to
    request that a new process be scheduled just before the
-   interrupt returns. */
-static bool in_external_intr;   /* Are we processing an external interrupt? */
-static bool yield_on_return;    /* Should we yield on interrupt return? */
+   interrupt returns.  Whether a CPU is processing an external
+   interrupt, and whether it should yield on return, is kept in
+   its struct cpu.
+
+   Work deferred by external interrupt handlers with intr_defer()
+   (see workqueue.h) goes on the CPU's list of softirqs.  After
+   acknowledging the outermost external interrupt, intr_handler()
+   runs it with interrupts turned back on, so that another
+   interrupt can be taken while it runs.  An interrupt taken then
+   queues its own deferred work behind, and defers any yield it
+   asks for until all of the work is done. */
+
+/* On a multiprocessor, turning interrupts off on one CPU does
+   not keep the others out, so the kernel's many "interrupts
+   off" critical sections also take intr_lock.  Once
+   intr_start_smp() has been called, a CPU holds intr_lock
+   whenever it has interrupts off: intr_disable() acquires it and
+   intr_enable() releases it, intr_handler() acquires it if the
+   CPU turned interrupts off to take the interrupt, and a thread
+   switch, which always happens with interrupts off, hands it
+   from one thread to the next on the same CPU. */
+static struct spinlock intr_lock = SPINLOCK_INITIALIZER;
+static bool intr_smp;           /* Is intr_lock in use? */
+
+static void run_softirqs (struct cpu *);
+
+static enum intr_level disable (void *caller);
+static enum intr_level enable (void);
+
+/* Returns the current TSC value, or 0 if there is no TSC, which
+   makes every measured interval 0. */
+static inline uint64_t
+timestamp (void) 
+{
+  return tsc_available () ? rdtsc () : 0;
+}
+
+/* Returns true if VEC is an external interrupt routed through
+   the PICs. */
+static inline bool
+is_pic_vec (uint8_t vec) 
+{
+  return vec >= 0x20 && vec < 0x30;
+}
+
+/* Returns true if VEC is an external interrupt raised by the
+   local APIC.  Its spurious-interrupt vector is excluded. */
+static inline bool
+is_lapic_vec (uint8_t vec) 
+{
+  return vec >= LAPIC_TIMER_VEC && vec < LAPIC_SPURIOUS_VEC;
+}
 
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
@@ -80,15 +157,50 @@ intr_get_level (void)
 enum intr_level
 intr_set_level (enum intr_level level) 
 {
-  return level == INTR_ON ? intr_enable () : intr_disable ();
+  return (level == INTR_ON
+          ? enable ()
+          : disable (__builtin_return_address (0)));
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_enable (void) 
+{
+  return enable ();
+}
+
+/* Disables interrupts and returns the previous interrupt status. */
+enum intr_level
+intr_disable (void) 
+{
+  return disable (__builtin_return_address (0));
+}
+
+/* Enables interrupts and returns the previous interrupt status.
+   Ends the interrupts-off window, if one is open. */
+static enum intr_level
+enable (void) 
 {
   enum intr_level old_level = intr_get_level ();
-  ASSERT (!intr_context ());
+
+  if (old_level == INTR_OFF) 
+    {
+      struct cpu *c = cpu_current ();
+      ASSERT (!c->in_external_intr);
+
+      if (c->off_caller != NULL) 
+        {
+          uint64_t cycles = timestamp () - c->off_start;
+          if (cycles > off_max_cycles) 
+            {
+              off_max_cycles = cycles;
+              off_max_caller = c->off_caller;
+            }
+          c->off_caller = NULL;
+        }
+      if (intr_smp)
+        spin_unlock (&intr_lock);
+    }
 
   /* Enable interrupts by setting the interrupt flag.
 
@@ -99,9 +211,11 @@ intr_enable (void)
   return old_level;
 }
 
-/* Disables interrupts and returns the previous interrupt status. */
-enum intr_level
-intr_disable (void) 
+/* Disables interrupts and returns the previous interrupt status.
+   If they were on, opens an interrupts-off window on behalf of
+   CALLER. */
+static enum intr_level
+disable (void *caller) 
 {
   enum intr_level old_level = intr_get_level ();
 
@@ -110,8 +224,45 @@ intr_disable (void)
      Hardware Interrupts". */
   asm volatile ("cli" : : : "memory");
 
+  if (old_level == INTR_ON) 
+    {
+      struct cpu *c = cpu_current ();
+      if (intr_smp)
+        spin_lock (&intr_lock);
+      c->off_start = timestamp ();
+      c->off_caller = caller;
+    }
+
   return old_level;
 }
+
+/* Enables interrupts and halts the CPU until the next interrupt
+   arrives.  Interrupts must be off.  Used by the idle thread.
+
+   The `sti' instruction disables interrupts until the completion
+   of the next instruction, so "sti; hlt" is executed atomically.
+   This atomicity is important; otherwise, an interrupt could be
+   handled between re-enabling interrupts and waiting for the
+   next one to occur, wasting as much as one clock tick worth of
+   time.  intr_lock is released before that, with interrupts
+   still off, but an interrupt sent to this CPU meanwhile stays
+   pending until the "sti", so it still ends the "hlt".
+
+   See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a] 7.11.1
+   "HLT Instruction". */
+void
+intr_wait (void) 
+{
+  struct cpu *c = cpu_current ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (!c->in_external_intr);
+
+  c->off_caller = NULL;
+  if (intr_smp)
+    spin_unlock (&intr_lock);
+  asm volatile ("sti; hlt" : : : "memory");
+}
 
 /* Initializes the interrupt system. */
 void
@@ -122,6 +273,7 @@ intr_init (void)
 
   /* Initialize interrupt controller. */
   pic_init ();
+  list_init (&cpu_current ()->softirqs);
 
   /* Initialize IDT. */
   for (i = 0; i < INTR_CNT; i++)
@@ -157,6 +309,41 @@ intr_init (void)
   intr_names[19] = "#XF SIMD Floating-Point Exception";
 }
 
+/* Sets up interrupt handling on an application processor, which
+   shares the BSP's IDT and handlers.  Called by the AP as it
+   starts, with interrupts off, after intr_start_smp(); takes
+   intr_lock to match. */
+void
+intr_init_ap (void) 
+{
+  uint64_t idtr_operand;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (intr_smp);
+
+  list_init (&cpu_current ()->softirqs);
+  idtr_operand = make_idtr_operand (sizeof idt - 1, idt);
+  asm volatile ("lidt %0" : : "m" (idtr_operand));
+
+  spin_lock (&intr_lock);
+}
+
+/* Starts using intr_lock to keep other CPUs out while interrupts
+   are off.  Called once, by the bootstrap processor, before it
+   starts any other CPU. */
+void
+intr_start_smp (void) 
+{
+  enum intr_level old_level;
+
+  ASSERT (!intr_smp);
+
+  old_level = intr_disable ();
+  spin_lock (&intr_lock);
+  intr_smp = true;
+  intr_set_level (old_level);
+}
+
 /* Registers interrupt VEC_NO to invoke HANDLER with descriptor
    privilege level DPL.  Names the interrupt NAME for debugging
    purposes.  The interrupt handler will be invoked with
@@ -176,12 +363,14 @@ register_handler (uint8_t vec_no, int dpl, enum intr_level level,
 
 /* Registers external interrupt VEC_NO to invoke HANDLER, which
    is named NAME for debugging purposes.  The handler will
-   execute with interrupts disabled. */
+   execute with interrupts disabled.  VEC_NO must be one of the
+   PIC's vectors 0x20...0x2f or one of the local APIC's vectors
+   0xf0...0xfe. */
 void
 intr_register_ext (uint8_t vec_no, intr_handler_func *handler,
                    const char *name) 
 {
-  ASSERT (vec_no >= 0x20 && vec_no <= 0x2f);
+  ASSERT (is_pic_vec (vec_no) || is_lapic_vec (vec_no));
   register_handler (vec_no, 0, INTR_OFF, handler, name);
 }
 
@@ -202,16 +391,30 @@ void
 intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
                    intr_handler_func *handler, const char *name)
 {
-  ASSERT (vec_no < 0x20 || vec_no > 0x2f);
+  ASSERT (!is_pic_vec (vec_no) && !is_lapic_vec (vec_no));
   register_handler (vec_no, dpl, level, handler, name);
 }
 
-/* Returns true during processing of an external interrupt
-   and false at all other times. */
+/* Returns true during processing of an external interrupt,
+   including the work it deferred with intr_defer(), and false at
+   all other times. */
 bool
 intr_context (void) 
 {
-  return in_external_intr;
+  uint32_t flags;
+  struct cpu *c;
+  bool in_context;
+
+  /* Keep interrupts off while we look, so that we cannot be
+     moved to another CPU in the middle.  Nothing shared is
+     touched, so there is no need to take intr_lock. */
+  asm volatile ("pushfl; popl %0; cli" : "=g" (flags) : : "memory");
+  c = cpu_current ();
+  in_context = c->in_external_intr || c->in_softirq;
+  if (flags & FLAG_IF)
+    asm volatile ("sti" : : : "memory");
+
+  return in_context;
 }
 
 /* During processing of an external interrupt, directs the
@@ -222,7 +425,54 @@ void
 intr_yield_on_return (void) 
 {
   ASSERT (intr_context ());
-  yield_on_return = true;
+  cpu_current ()->yield_on_return = true;
+}
+
+/* During processing of an external interrupt, queues W to run
+   just before the interrupt returns, with interrupts on.
+   Returns true if W was queued, false if it was already
+   pending.  See workqueue.h for details. */
+bool
+intr_defer (struct work *w) 
+{
+  enum intr_level old_level;
+  bool queued = false;
+
+  ASSERT (intr_context ());
+
+  old_level = intr_disable ();
+  if (!w->pending) 
+    {
+      w->pending = true;
+      list_push_back (&cpu_current ()->softirqs, &w->elem);
+      queued = true;
+    }
+  intr_set_level (old_level);
+
+  return queued;
+}
+
+/* Runs the work deferred with intr_defer() on CPU C, the running
+   CPU, in order, with interrupts on, until there is none left.
+   Interrupts must be off on entry, and are off again on return.
+   We stay on C throughout, because nothing yields until the
+   work is done. */
+static void
+run_softirqs (struct cpu *c) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  c->in_softirq = true;
+  while (!list_empty (&c->softirqs)) 
+    {
+      struct work *w = list_entry (list_pop_front (&c->softirqs),
+                                   struct work, elem);
+      w->pending = false;
+      intr_enable ();
+      w->func (w);
+      intr_disable ();
+    }
+  c->in_softirq = false;
 }
 
 /* 8259A Programmable Interrupt Controller. */
@@ -346,30 +596,59 @@ intr_handler (struct intr_frame *frame)
 {
   bool external;
   intr_handler_func *handler;
+  struct intr_stats *stats = &intr_stats[frame->vec_no];
+  struct cpu *c = cpu_current ();
+  enum intr_level old_level;
+  uint64_t start = 0;
+
+  /* If we came through an interrupt gate, which turned
+     interrupts off, take intr_lock to match, unless the
+     interrupted code already held it. */
+  if (intr_smp && intr_get_level () == INTR_OFF && !spin_held (&intr_lock))
+    spin_lock (&intr_lock);
 
   /* External interrupts are special.
      We only handle one at a time (so interrupts must be off)
      and they need to be acknowledged on the PIC (see below).
      An external interrupt handler cannot sleep. */
-  external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+  external = is_pic_vec (frame->vec_no) || is_lapic_vec (frame->vec_no);
   if (external) 
     {
       ASSERT (intr_get_level () == INTR_OFF);
-      ASSERT (!intr_context ());
-
-      in_external_intr = true;
-      yield_on_return = false;
+      ASSERT (!c->in_external_intr);
+
+      c->in_external_intr = true;
+      if (!c->in_softirq)
+        c->yield_on_return = false;
+      trace_event (TRACE_INTR_ENTER, thread_current ()->tid, frame->vec_no);
+
+      /* If the interrupted code had interrupts on, then any
+         interrupts-off window still open was closed without
+         intr_enable(). */
+      if (frame->eflags & FLAG_IF)
+        c->off_caller = NULL;
+      start = timestamp ();
     }
 
+  /* Count the invocation.  A trap gate leaves interrupts on, so
+     another CPU may be counting the same vector at once: turn
+     them off, which takes intr_lock, around the update. */
+  old_level = intr_disable ();
+  stats->cnt++;
+  intr_set_level (old_level);
+
   /* Invoke the interrupt's handler. */
   handler = intr_handlers[frame->vec_no];
   if (handler != NULL)
     handler (frame);
-  else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f)
+  else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f
+           || frame->vec_no == LAPIC_SPURIOUS_VEC)
     {
       /* There is no handler, but this interrupt can trigger
          spuriously due to a hardware fault or hardware race
-         condition.  Ignore it. */
+         condition.  Ignore it.  (The local APIC's spurious
+         vector must not be acknowledged, so it is not treated
+         as external.) */
     }
   else
     unexpected_interrupt (frame);
@@ -377,14 +656,50 @@ intr_handler (struct intr_frame *frame)
   /* Complete the processing of an external interrupt. */
   if (external) 
     {
+      uint64_t cycles = timestamp () - start;
+
       ASSERT (intr_get_level () == INTR_OFF);
       ASSERT (intr_context ());
 
-      in_external_intr = false;
-      pic_end_of_interrupt (frame->vec_no); 
+      stats->total_cycles += cycles;
+      if (cycles > stats->max_cycles)
+        stats->max_cycles = cycles;
+
+      c->in_external_intr = false;
+      trace_event (TRACE_INTR_EXIT, thread_current ()->tid, frame->vec_no);
+      if (is_pic_vec (frame->vec_no))
+        pic_end_of_interrupt (frame->vec_no); 
+      else
+        lapic_eoi ();
+
+      /* Run deferred work, unless this interrupt arrived while
+         an earlier one's was running, and then yield if the
+         handler or the deferred work asked to. */
+      if (!c->in_softirq) 
+        {
+          run_softirqs (c);
+          if (c->yield_on_return) 
+            thread_preempt (); 
+        }
+    }
 
-      if (yield_on_return) 
-        thread_yield (); 
+  /* The interrupted code gets its interrupt flag back from
+     FRAME when we return, so hold intr_lock or not to match.
+     After yielding we may be on a different CPU from the one
+     that took the interrupt, which is why this looks at
+     intr_lock afresh. */
+  if (intr_smp) 
+    {
+      if (frame->eflags & FLAG_IF) 
+        {
+          if (intr_get_level () == INTR_OFF && spin_held (&intr_lock))
+            spin_unlock (&intr_lock);
+        }
+      else if (!spin_held (&intr_lock)) 
+        {
+          asm volatile ("cli" : : : "memory");
+          spin_lock (&intr_lock);
+        }
     }
 }
 
@@ -436,3 +751,31 @@ intr_name (uint8_t vec)
 {
   return intr_names[vec];
 }
+
+/* Prints interrupt statistics: for each vector that was invoked,
+   the number of invocations and, for external interrupts, the
+   average and longest time spent in the handler, then the
+   longest time that interrupts were turned off outside a
+   handler and the code that turned them off. */
+void
+intr_print_stats (void) 
+{
+  int i;
+
+  for (i = 0; i < INTR_CNT; i++) 
+    {
+      const struct intr_stats *s = &intr_stats[i];
+      if (s->cnt == 0)
+        continue;
+      printf ("Interrupt %#04x (%s): %lld calls", i, intr_names[i], s->cnt);
+      if (is_pic_vec (i) || is_lapic_vec (i))
+        printf (", %"PRIu64" cycles average, %"PRIu64" max",
+                s->total_cycles / s->cnt, s->max_cycles);
+      printf ("\n");
+    }
+
+  if (off_max_caller != NULL)
+    printf ("Interrupts: off for at most %"PRIu64" cycles (%"PRIu64" us), "
+            "turned off at %p\n", off_max_cycles,
+            tsc_to_ns (off_max_cycles) / 1000, off_max_caller);
+}
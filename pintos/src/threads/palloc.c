@@ -9,6 +9,7 @@
 #include <string.h>
 #include "threads/loader.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -66,7 +67,10 @@ palloc_init (size_t user_page_limit)
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
    then the pages are filled with zeros.  If too few pages are
    available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
+   FLAGS, in which case the kernel panics.
+
+   If the kernel pool runs out, the pages cached for reuse by new
+   threads are given back and the allocation is retried. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
@@ -81,6 +85,14 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
   lock_release (&pool->lock);
 
+  if (page_idx == BITMAP_ERROR && pool == &kernel_pool
+      && thread_cache_reclaim () > 0)
+    {
+      lock_acquire (&pool->lock);
+      page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+      lock_release (&pool->lock);
+    }
+
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
   else
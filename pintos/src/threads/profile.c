@@ -0,0 +1,182 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+/* Statistical profiler.
+
+   On every timer interrupt, profile_sample() records the
+   instruction pointer that the interrupt found, and, if the CPU
+   was running a user program, which thread it belongs to, by
+   bumping a counter in a histogram.  At shutdown, profile_dump()
+   prints the histogram, and utils/pintos-profile looks up the
+   addresses in kernel.o and the user programs to produce a
+   ranked profile by function.
+
+   The histogram is an open-addressing hash table of
+   profile_pages pages, allocated only if profiling is enabled.
+   It is only touched from the timer interrupt handler and at
+   shutdown, so it needs no locking.  A sample whose bucket
+   cannot be found because the table is full is counted as
+   dropped. */
+
+/* One histogram bucket. */
+struct bucket
+  {
+    uintptr_t eip;              /* Interrupted instruction. */
+    tid_t tid;                  /* User thread, or 0 for kernel mode. */
+    uint32_t count;             /* Number of samples. */
+  };
+
+/* Name of a thread that was sampled in user mode, so that the
+   profile can name the program whose symbols to use. */
+struct sampled_thread
+  {
+    tid_t tid;
+    char name[16];
+  };
+
+bool profile_enabled;
+size_t profile_pages;
+
+/* Histogram. */
+static struct bucket *buckets;
+static size_t bucket_cnt;       /* Number of buckets, a power of 2. */
+static size_t used_cnt;         /* Number of buckets in use. */
+
+/* Names of sampled user threads. */
+static struct sampled_thread *threads;
+static size_t thread_cnt;
+#define THREADS_MAX (PGSIZE / sizeof (struct sampled_thread))
+
+/* Statistics. */
+static long long sample_cnt;    /* Samples taken. */
+static long long dropped_cnt;   /* Samples lost to a full table. */
+
+static void note_thread (const struct thread *);
+
+/* Initializes the profiler, if profile_pages is nonzero.  Must
+   be called after the page allocator is initialized. */
+void
+profile_init (void)
+{
+  if (profile_pages == 0)
+    return;
+
+  buckets = palloc_get_multiple (PAL_ZERO, profile_pages);
+  threads = palloc_get_page (0);
+  if (buckets == NULL || threads == NULL)
+    PANIC ("profile: cannot allocate %zu-page histogram", profile_pages);
+
+  /* Round the number of buckets down to a power of 2, so that
+     hashing is a mask. */
+  bucket_cnt = profile_pages * PGSIZE / sizeof *buckets;
+  while ((bucket_cnt & (bucket_cnt - 1)) != 0)
+    bucket_cnt &= bucket_cnt - 1;
+  profile_enabled = true;
+}
+
+/* Records a sample of the code that frame F interrupted.
+   Called through profile_sample() from the timer interrupt. */
+void
+profile_record (const struct intr_frame *f)
+{
+  struct thread *t = thread_current ();
+  tid_t tid = (f->cs & 3) == 3 ? t->tid : 0;
+  uintptr_t eip = (uintptr_t) f->eip;
+  size_t i, probes;
+
+  ASSERT (intr_context ());
+
+  sample_cnt++;
+  i = ((eip >> 2) * 0x9e3779b1u + tid) & (bucket_cnt - 1);
+  for (probes = 0; probes < bucket_cnt; probes++)
+    {
+      struct bucket *b = &buckets[i];
+      if (b->count == 0)
+        {
+          /* Leave a few buckets free, so that a miss does not
+             have to probe the whole table. */
+          if (used_cnt >= bucket_cnt - bucket_cnt / 8)
+            break;
+          b->eip = eip;
+          b->tid = tid;
+          used_cnt++;
+          if (tid != 0)
+            note_thread (t);
+        }
+      if (b->eip == eip && b->tid == tid)
+        {
+          b->count++;
+          return;
+        }
+      i = (i + 1) & (bucket_cnt - 1);
+    }
+  dropped_cnt++;
+}
+
+/* Remembers T's name, if T has not been sampled in user mode
+   before. */
+static void
+note_thread (const struct thread *t)
+{
+  size_t i;
+
+  for (i = 0; i < thread_cnt; i++)
+    if (threads[i].tid == t->tid)
+      return;
+  if (thread_cnt < THREADS_MAX)
+    {
+      threads[thread_cnt].tid = t->tid;
+      strlcpy (threads[thread_cnt].name, t->name,
+               sizeof threads[thread_cnt].name);
+      thread_cnt++;
+    }
+}
+
+/* Returns the name of user thread TID, or "?" if unknown. */
+static const char *
+thread_name_of (tid_t tid)
+{
+  size_t i;
+
+  for (i = 0; i < thread_cnt; i++)
+    if (threads[i].tid == tid)
+      return threads[i].name;
+  return "?";
+}
+
+/* Stops profiling and prints the histogram, one "Profile:"
+   line per bucket in use, for utils/pintos-profile. */
+void
+profile_dump (void)
+{
+  size_t i;
+
+  if (buckets == NULL)
+    return;
+  profile_enabled = false;
+
+  printf ("Profile: %lld samples, %lld dropped, %d Hz\n",
+          sample_cnt, dropped_cnt, TIMER_FREQ);
+  for (i = 0; i < bucket_cnt; i++)
+    {
+      const struct bucket *b = &buckets[i];
+      if (b->count == 0)
+        continue;
+      if (b->tid == 0)
+        printf ("Profile: kernel %#010"PRIxPTR" %"PRIu32"\n",
+                b->eip, b->count);
+      else
+        printf ("Profile: user %d %s %#010"PRIxPTR" %"PRIu32"\n",
+                b->tid, thread_name_of (b->tid), b->eip, b->count);
+    }
+  printf ("Profile: end\n");
+}
@@ -0,0 +1,34 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct intr_frame;
+
+/* If false (default), profile_sample() does nothing.
+   Set by profile_init() if kernel command-line option
+   "-profile" was given. */
+extern bool profile_enabled;
+
+/* Histogram size, in pages, or 0 to disable profiling.
+   Set by kernel command-line option "-profile". */
+extern size_t profile_pages;
+
+/* Histogram size for "-profile" without a size. */
+#define PROFILE_DEFAULT_PAGES 16
+
+void profile_init (void);
+void profile_record (const struct intr_frame *);
+void profile_dump (void);
+
+/* Records a sample of the code that frame F interrupted, if
+   profiling is enabled. */
+static inline void
+profile_sample (const struct intr_frame *f)
+{
+  if (profile_enabled)
+    profile_record (f);
+}
+
+#endif /* threads/profile.h */
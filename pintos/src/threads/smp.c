@@ -0,0 +1,289 @@
+#include "threads/smp.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/lapic.h"
+#include "devices/mp.h"
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Symmetric multiprocessing.
+
+   The bootstrap processor (BSP) boots the kernel alone.  Once
+   the scheduler and timer are running, smp_start() wakes up each
+   application processor (AP) that mp_init() found, with the
+   INIT-SIPI-SIPI sequence from the MultiProcessor Specification,
+   appendix B.4.  Each AP runs ap-start.S and then ap_main(),
+   which starts its local APIC timer and settles into an idle
+   thread of its own.  From then on every CPU schedules threads
+   from the one shared run queue, under intr_lock (see
+   interrupt.c), and a CPU that makes a thread ready while
+   another one is idle sends it LAPIC_RESCHED_VEC to come and
+   get it.
+
+   This is deliberately less than full SMP.  Threads run in
+   parallel only while they have interrupts on: every "interrupts
+   off" section, which includes all of the scheduler, still
+   excludes every other CPU.  There are no per-CPU run queues or
+   work stealing, because the priority, stride, and deadline
+   classes in thread.c all rely on one queue holding every ready
+   thread to pick the right one.  There is no TLB shootdown,
+   because APs only run kernels without user programs, whose
+   threads all share init_page_dir, which never loses a mapping.
+   Processors are found through the MP tables only, not ACPI. */
+
+/* Page-aligned physical address below 1 MB to which the AP
+   startup code is copied.  A Startup IPI can only name such an
+   address.  The loader ran at 0x7c00, but is done with now. */
+#define AP_START_PHYS 0x7000
+
+/* How long to wait for each AP to start, in milliseconds. */
+#define AP_START_TIMEOUT 100
+
+/* Processors, indexed by mp.c's CPU number.  The BSP is
+   cpus[0]. */
+static struct cpu cpus[MP_MAX_CPUS];
+
+/* Number of CPUs running the kernel, including the BSP. */
+static int cpu_cnt = 1;
+
+/* Has smp_start() begun starting APs?  Until it has, the BSP is
+   the only CPU and cpu_current() need not look at the running
+   thread, which may not exist yet. */
+static bool smp_active;
+
+/* AP startup code, in ap-start.S. */
+extern const char ap_start[], ap_start_end[];
+extern uint32_t ap_start_pd;
+
+/* Initial stack pointer for the AP being started.  Used by
+   ap-start.S. */
+void *ap_start_esp;
+
+void ap_main (void) NO_RETURN;
+static bool start_ap (struct cpu *);
+static intr_handler_func ap_timer_interrupt;
+static intr_handler_func resched_interrupt;
+
+/* Starts the application processors, if there are any and this
+   kernel can use them.  Must be called by the BSP, with
+   interrupts on, after the scheduler and timer are running. */
+void
+smp_start (void)
+{
+  enum intr_level old_level;
+  uint32_t *pd;
+  bool lapic_ok;
+  int i;
+
+  cpus[0].apic_id = mp_cpu_apic_id (0);
+  cpus[0].started = true;
+  if (mp_cpu_cnt () == 1)
+    return;
+
+#ifdef USERPROG
+  /* User processes need a TSS, and so a GDT, per CPU, which
+     userprog/tss.c and userprog/gdt.c do not provide. */
+  printf ("SMP: user programs need one CPU, using CPU %"PRIu8" only.\n",
+          cpus[0].apic_id);
+  return;
+#endif
+
+  old_level = intr_disable ();
+  lapic_ok = lapic_init ();
+  intr_set_level (old_level);
+  if (!lapic_ok)
+    {
+      printf ("SMP: no local APIC, using CPU %"PRIu8" only.\n",
+              cpus[0].apic_id);
+      return;
+    }
+
+  intr_register_ext (LAPIC_AP_TIMER_VEC, ap_timer_interrupt, "AP Timer");
+  intr_register_ext (LAPIC_RESCHED_VEC, resched_interrupt, "Reschedule");
+
+  /* The APs start with the kernel's page directory, plus an
+     identity mapping for the low 4 MB that holds the copy of
+     the startup code, which runs at its physical address until
+     it jumps into the kernel.  lapic_init() has already mapped
+     the APIC registers into init_page_dir. */
+  pd = palloc_get_page (PAL_ASSERT);
+  memcpy (pd, init_page_dir, PGSIZE);
+  pd[0] = pd[pd_no (PHYS_BASE)];
+  memcpy (ptov (AP_START_PHYS), ap_start, ap_start_end - ap_start);
+  *(uint32_t *) ptov (AP_START_PHYS + ((const char *) &ap_start_pd
+                                       - ap_start)) = vtop (pd);
+
+  intr_start_smp ();
+  smp_active = true;
+  for (i = 1; i < mp_cpu_cnt (); i++)
+    {
+      struct cpu *c = &cpus[i];
+      c->id = i;
+      c->apic_id = mp_cpu_apic_id (i);
+      if (start_ap (c))
+        cpu_cnt++;
+      else
+        {
+          /* The AP might still start later, and then it would
+             need the startup page directory, so don't free it. */
+          printf ("SMP: CPU %"PRIu8" did not start.\n", c->apic_id);
+          pd = NULL;
+        }
+    }
+  if (pd != NULL)
+    palloc_free_page (pd);
+
+  printf ("SMP: %d of %d CPUs running.\n", cpu_cnt, mp_cpu_cnt ());
+}
+
+/* Creates an idle thread for C and wakes up C with INIT and
+   Startup IPIs, following the MultiProcessor Specification,
+   appendix B.4.1.  Returns true if C started within
+   AP_START_TIMEOUT ms, false otherwise. */
+static bool
+start_ap (struct cpu *c)
+{
+  enum intr_level old_level;
+  struct thread *t;
+  int ms;
+
+  t = thread_create_idle (c);
+  if (t == NULL)
+    return false;
+  ap_start_esp = (uint8_t *) t + PGSIZE;
+
+  old_level = intr_disable ();
+  lapic_send_init (c->apic_id);
+  intr_set_level (old_level);
+  timer_mdelay (10);
+
+  /* A second Startup IPI, as the specification recommends, in
+     case the first one is lost. */
+  old_level = intr_disable ();
+  lapic_send_startup (c->apic_id, AP_START_PHYS);
+  intr_set_level (old_level);
+  timer_udelay (200);
+  if (!c->started)
+    {
+      old_level = intr_disable ();
+      lapic_send_startup (c->apic_id, AP_START_PHYS);
+      intr_set_level (old_level);
+    }
+
+  for (ms = 0; !c->started && ms < AP_START_TIMEOUT; ms++)
+    timer_mdelay (1);
+  return c->started;
+}
+
+/* Runs on an application processor after ap-start.S, with
+   interrupts off, on the stack of the idle thread that
+   start_ap() created for it. */
+void
+ap_main (void)
+{
+  struct cpu *c = cpu_current ();
+
+  /* Switch to the kernel's own page directory, leaving the
+     startup page directory to be freed. */
+  asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir))
+                : "memory");
+
+  intr_init_ap ();
+  lapic_init_ap ();
+  lapic_timer_periodic (LAPIC_AP_TIMER_VEC, lapic_timer_hz () / TIMER_FREQ);
+  c->started = true;
+  thread_start_ap ();
+}
+
+/* Returns the number of CPUs running the kernel. */
+int
+smp_cpu_cnt (void)
+{
+  return cpu_cnt;
+}
+
+/* Returns the number of the CPU we are running on, 0 for the
+   BSP.  Unless interrupts are off, the running thread may move
+   to another CPU at any time, so the answer may be stale. */
+int
+smp_cpu_id (void)
+{
+  enum intr_level old_level = intr_disable ();
+  int id = cpu_current ()->id;
+  intr_set_level (old_level);
+  return id;
+}
+
+/* Returns the CPU we are running on.  Only meaningful with
+   interrupts off, since otherwise the running thread may move to
+   another CPU at any time. */
+struct cpu *
+cpu_current (void)
+{
+  uint32_t *esp;
+
+  if (!smp_active)
+    return &cpus[0];
+
+  /* Like running_thread(), which we cannot call because it
+     checks that the thread is running, which it may not yet be
+     while it is being switched to. */
+  asm ("mov %%esp, %0" : "=g" (esp));
+  return ((struct thread *) pg_round_down (esp))->cpu;
+}
+
+/* Called with interrupts off after a thread has been added to
+   the run queue.  If another CPU is idle, sends it an interrupt
+   so that it runs the new thread.  The running CPU will find the
+   thread itself if it is idle; otherwise, it's busy, and the new
+   thread waits for one of them to become available. */
+void
+smp_wake_idle (void)
+{
+  struct cpu *self;
+  int i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (cpu_cnt == 1)
+    return;
+
+  self = cpu_current ();
+  if (self->idle)
+    return;
+  for (i = 0; i < mp_cpu_cnt (); i++)
+    {
+      struct cpu *c = &cpus[i];
+      if (c != self && c->started && c->idle)
+        {
+          /* Only wake it once, even if more threads become ready
+             before it gets here. */
+          c->idle = false;
+          lapic_send_ipi (c->apic_id, LAPIC_RESCHED_VEC);
+          return;
+        }
+    }
+}
+
+/* Local APIC timer interrupt on an AP: a scheduler tick. */
+static void
+ap_timer_interrupt (struct intr_frame *args UNUSED)
+{
+  thread_tick ();
+}
+
+/* LAPIC_RESCHED_VEC interrupt: smp_wake_idle() wants this CPU to
+   stop idling and look at the run queue. */
+static void
+resched_interrupt (struct intr_frame *args UNUSED)
+{
+  if (thread_current () == cpu_current ()->idle_thread)
+    intr_yield_on_return ();
+}
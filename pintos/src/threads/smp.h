@@ -0,0 +1,44 @@
+#ifndef THREADS_SMP_H
+#define THREADS_SMP_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* A processor.
+
+   Each CPU has its own idle thread, time slice, and interrupt
+   state.  Everything else, including the run queue, is shared
+   by all of them and protected by turning interrupts off, which
+   on a multiprocessor also takes intr_lock (see interrupt.c).
+
+   A CPU only looks at its own struct cpu, with interrupts off,
+   except that other CPUs may test and clear `idle' while holding
+   intr_lock. */
+struct cpu
+  {
+    int id;                     /* Index in cpus[], 0 for the BSP. */
+    uint8_t apic_id;            /* Local APIC ID. */
+    volatile bool started;      /* Running the kernel yet? */
+    bool idle;                  /* Running its idle thread? */
+
+    /* Owned by threads/thread.c. */
+    struct thread *idle_thread; /* Runs when nothing else is ready. */
+    unsigned thread_ticks;      /* # of timer ticks since last yield. */
+
+    /* Owned by threads/interrupt.c. */
+    bool in_external_intr;      /* Processing an external interrupt? */
+    bool yield_on_return;       /* Yield on interrupt return? */
+    bool in_softirq;            /* Running deferred work? */
+    struct list softirqs;       /* Work deferred by intr_defer(). */
+    uint64_t off_start;         /* When interrupts went off. */
+    void *off_caller;           /* Who turned them off, or null. */
+  };
+
+void smp_start (void);
+int smp_cpu_cnt (void);
+int smp_cpu_id (void);
+struct cpu *cpu_current (void);
+void smp_wake_idle (void);
+
+#endif /* threads/smp.h */
@@ -0,0 +1,72 @@
+#include "threads/spinlock.h"
+#include <debug.h>
+#include <stddef.h>
+#include "threads/interrupt.h"
+#include "threads/smp.h"
+
+/* Atomically stores NEW into *P and returns its old value.
+   XCHG with a memory operand locks the bus by itself, and is a
+   full memory barrier.  See [IA32-v2b] "XCHG". */
+static inline int
+xchg (volatile int *p, int new)
+{
+  asm volatile ("xchgl %0, %1" : "+r" (new), "+m" (*p) : : "memory");
+  return new;
+}
+
+/* Initializes L as not held. */
+void
+spin_init (struct spinlock *l)
+{
+  ASSERT (l != NULL);
+
+  l->locked = 0;
+  l->holder = NULL;
+}
+
+/* Acquires L, spinning until it is available.  Interrupts must
+   be off, and the running CPU must not already hold L. */
+void
+spin_lock (struct spinlock *l)
+{
+  ASSERT (l != NULL);
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (!spin_held (l));
+
+  while (xchg (&l->locked, 1) != 0)
+    {
+      /* Wait until L looks free before trying again, so that
+         waiting CPUs do not keep taking the bus from the
+         holder.  PAUSE tells the CPU that this is a spin-wait
+         loop.  See [IA32-v2b] "PAUSE". */
+      while (l->locked)
+        asm volatile ("pause" : : : "memory");
+    }
+  l->holder = cpu_current ();
+}
+
+/* Releases L, which the running CPU must hold. */
+void
+spin_unlock (struct spinlock *l)
+{
+  ASSERT (l != NULL);
+  ASSERT (spin_held (l));
+
+  l->holder = NULL;
+
+  /* x86 does not reorder stores with older loads or stores, so
+     a plain store releases the lock, as long as the compiler
+     keeps it after the critical section. */
+  asm volatile ("" : : : "memory");
+  l->locked = 0;
+}
+
+/* Returns true if the running CPU holds L, false otherwise.
+   The answer is only stable with interrupts off. */
+bool
+spin_held (const struct spinlock *l)
+{
+  ASSERT (l != NULL);
+
+  return l->locked && l->holder == cpu_current ();
+}
@@ -0,0 +1,30 @@
+#ifndef THREADS_SPINLOCK_H
+#define THREADS_SPINLOCK_H
+
+#include <stdbool.h>
+
+struct cpu;
+
+/* A spinlock, for mutual exclusion between CPUs.
+
+   A CPU that wants a spinlock that another CPU holds busy-waits
+   until it is released, so spinlocks must only be held briefly,
+   and only with interrupts off: otherwise an interrupt handler
+   on the holding CPU could wait forever for the lock that it
+   interrupted.  A spinlock is held by a CPU, not a thread, and
+   is not recursive. */
+struct spinlock
+  {
+    volatile int locked;        /* Nonzero while held. */
+    struct cpu *holder;         /* CPU holding the lock, or null. */
+  };
+
+/* Initializer for a spinlock that is not held. */
+#define SPINLOCK_INITIALIZER { 0, NULL }
+
+void spin_init (struct spinlock *);
+void spin_lock (struct spinlock *);
+void spin_unlock (struct spinlock *);
+bool spin_held (const struct spinlock *);
+
+#endif /* threads/spinlock.h */
@@ -31,9 +31,30 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
-
-static int MAX_NESTED_LEVEL = 8;
-bool flag = false;
+#include "threads/trace.h"
+
+/* Maximum number of lock holders that a donation passes
+   through: if H waits for a lock held by M, which waits for a
+   lock held by L, then H's priority reaches L at depth 2.
+   Donations beyond this depth take effect only once the threads
+   in between release or acquire a lock.  Set with kernel
+   command-line option "-donate-depth". */
+int lock_donate_depth = 8;
+
+/* Incremented each time a thread joins a wait queue, so that
+   waiters of equal priority are woken first-come, first-served. */
+static unsigned wait_seq;
+
+static void wait_queue_init (struct pheap *);
+static void wait_queue_push (struct pheap *, struct thread *);
+static struct thread *wait_queue_pop (struct pheap *);
+static void wake_up (struct thread *);
+static pheap_less_func waiter_more;
+
+static void donate (struct lock *);
+static bool update_priority (struct thread *);
+static int waiters_priority (const struct semaphore *);
+static pheap_less_func lock_more;
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -50,16 +71,7 @@ sema_init (struct semaphore *sema, unsigned value)
   ASSERT (sema != NULL);
 
   sema->value = value;
-  list_init (&sema->waiters);
-}
-
-static bool 
-sort_by_priority (const struct list_elem *a_, const struct list_elem *b_,
-                      void *aux UNUSED) 
-{
-  const struct thread *a = list_entry (a_, struct thread, elem);
-  const struct thread *b = list_entry (b_, struct thread, elem);
-  return a->priority > b->priority; 
+  wait_queue_init (&sema->waiters);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -79,14 +91,11 @@ sema_down (struct semaphore *sema)
 
   old_level = intr_disable ();
   while (sema->value == 0) 
-  {
-    list_push_back (&sema->waiters, &thread_current ()->elem);
-    list_sort(&sema->waiters, sort_by_priority, NULL);
-    thread_block ();
-  }
-
+    {
+      wait_queue_push (&sema->waiters, thread_current ());
+      thread_block ();
+    }
   sema->value--;
-  thread_current()->lock_waiting_for = NULL;
   intr_set_level (old_level);
 }
 
@@ -117,7 +126,8 @@ sema_try_down (struct semaphore *sema)
 }
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
-   and wakes up one thread of those waiting for SEMA, if any.
+   and wakes up the highest-priority thread of those waiting for
+   SEMA, if any.
 
    This function may be called from an interrupt handler. */
 void
@@ -127,21 +137,10 @@ sema_up (struct semaphore *sema)
 
   ASSERT (sema != NULL);
 
-  struct thread *wt;
-
   old_level = intr_disable ();
-  if (!list_empty (&sema->waiters))
-  {
-    //PANIC("\n\ntest\n");
-    list_sort(&sema->waiters, sort_by_priority, NULL);
-    wt = list_entry (list_pop_front (&sema->waiters), struct thread, elem);
-    thread_unblock (wt);
-  }
   sema->value++;
-
-  if (wt->priority > thread_current()->priority)
-    thread_yield();
-
+  if (!pheap_empty (&sema->waiters))
+    wake_up (wait_queue_pop (&sema->waiters));
   intr_set_level (old_level);
 }
 
@@ -204,59 +203,65 @@ lock_init (struct lock *lock)
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+  lock->priority = PRI_MIN - 1;
+}
+
+/* Initializes the lock-related members of new thread T. */
+void
+lock_init_holder (struct thread *t) 
+{
+  pheap_init (&t->held_locks, lock_more, NULL);
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
 
+   While we wait, we donate our priority to the lock's holder,
+   and through any lock that it waits for in turn, to a depth of
+   lock_donate_depth.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
    we need to sleep. */
-void
-priority_donation(struct lock *lock)
-{
-  struct thread *ct = thread_current();
-  struct thread *lh = lock->holder;
-
-  if (lh != NULL)
-  {
-    if (lh->priority < ct->priority)
-    {
-      if (lh->donation_nested_level < MAX_NESTED_LEVEL)
-      {
-      	if (lh->donation_nested_level == 0)
-      	  lh->orig_priority = lh->priority;
-
-      	if (!list_exist(&lock->holder->lock_list, &lock->elem))
-      	{
-          lh->donation_nested_level++;
-      	  list_push_back(&lock->holder->lock_list, &lock->elem);
-      	}
-      	lh->priority = ct->priority;
-
-        if (lh->lock_waiting_for != NULL)
-          priority_donation(lh->lock_waiting_for);
-      }
-    }
-
-  }
-}
-
 void
 lock_acquire (struct lock *lock)
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
-  priority_donation(lock);
-
-  thread_current()->lock_waiting_for = lock;
+  /* This is sema_down(), plus donation to the holder each time
+     we start waiting. */
+  old_level = intr_disable ();
+  while (lock->semaphore.value == 0) 
+    {
+      wait_queue_push (&lock->semaphore.waiters, cur);
+
+      /* The MLFQS does not use priority donation. */
+      if (!thread_mlfqs)
+        {
+          cur->waiting_lock = lock;
+          donate (lock);
+        }
+      thread_block ();
+    }
+  lock->semaphore.value--;
+  cur->waiting_lock = NULL;
 
-  sema_down (&lock->semaphore);
-  lock->holder = thread_current();
+  lock->holder = cur;
+  if (!thread_mlfqs)
+    {
+      /* The threads still waiting now donate to us. */
+      lock->priority = waiters_priority (&lock->semaphore);
+      pheap_push (&cur->held_locks, &lock->holder_elem);
+      update_priority (cur);
+    }
+  intr_set_level (old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -268,76 +273,33 @@ lock_acquire (struct lock *lock)
 bool
 lock_try_acquire (struct lock *lock)
 {
+  enum intr_level old_level;
   bool success;
 
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
-  
+
+  old_level = intr_disable ();
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
-  return success;
-}
-
-int
-priority_restoration(struct lock *lock)
-{
-  struct thread *ct = thread_current();
-  struct list *ll = &ct->lock_list;
-
-  if (ct->donation_nested_level == 0)
-    return -1;
-
-  // not donated by this lock struct
-  if (!list_exist(ll, &lock->elem))
-    return -1;
-
-  // donated by this lock struct
-  ct->donation_nested_level--;    /* anyway, decrease */
-  struct thread *unblocked_thread = list_entry(list_begin(&lock->semaphore.waiters), struct thread, elem);
-  
-  // Most recently donated by this lock struct
-  if(unblocked_thread->priority == ct->priority)
-  {
-    // remove from donor lock list
-    list_remove(&lock->elem);
-
-    if (ct->donation_nested_level == 0)
-    {
-      // We need to assert there is no donors
-      return ct->orig_priority;
-    }
-
-    int restored_priority = 0;
-
-    struct list_elem *e;
-    e = list_begin(ll);
-
-    // Find next highest priority from donors.
-    for (; e != list_end(ll); e = list_next(e))
     {
-      struct lock *cl = list_entry(e, struct lock, elem);
-      struct thread *temp_lock_thread;
-
-      if (!list_empty(&cl->semaphore.waiters))
-        temp_lock_thread = list_entry(list_begin(&cl->semaphore.waiters), struct thread, elem);
-      else
-        continue;
-
-      int tltp = temp_lock_thread->priority;
-
-      if (tltp > restored_priority)
-        restored_priority = tltp;
+      struct thread *cur = thread_current ();
+
+      lock->holder = cur;
+      if (!thread_mlfqs)
+        {
+          lock->priority = waiters_priority (&lock->semaphore);
+          pheap_push (&cur->held_locks, &lock->holder_elem);
+          update_priority (cur);
+        }
     }
+  intr_set_level (old_level);
 
-    return restored_priority;
-  }
-  // donated long time ago. No effect.
-  else
-    return ct->priority;
+  return success;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
+   Gives up the priority donated through LOCK, if any.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
@@ -345,20 +307,21 @@ priority_restoration(struct lock *lock)
 void
 lock_release (struct lock *lock) 
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
-  int priority_restore = priority_restoration(lock);
-
+  old_level = intr_disable ();
   lock->holder = NULL;
-
-  if (priority_restore >= 0)
-  {
-    //thread_set_priority(priority_restore);
-    thread_current()->priority = priority_restore;
-  }
-
+  if (!thread_mlfqs)
+    {
+      pheap_remove (&cur->held_locks, &lock->holder_elem);
+      update_priority (cur);
+    }
   sema_up (&lock->semaphore);
+  intr_set_level (old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -369,18 +332,101 @@ lock_held_by_current_thread (const struct lock *lock)
 {
   ASSERT (lock != NULL);
 
-  // Can you find this?
-
   return lock->holder == thread_current ();
 }
-
-/* One semaphore in a list. */
-struct semaphore_elem 
+
+/* Returns the highest priority donated to thread T through the
+   locks it holds, or PRI_MIN - 1 if there is none.  Interrupts
+   must be off. */
+int
+lock_donated_priority (const struct thread *t) 
+{
+  struct pheap_elem *top = pheap_top (&t->held_locks);
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  return top != NULL ? pheap_entry (top, struct lock, holder_elem)->priority
+                     : PRI_MIN - 1;
+}
+
+/* Passes a change in the set of threads waiting for LOCK, or in
+   their priorities, on to LOCK's holder.  If that changes the
+   holder's effective priority and the holder is itself waiting
+   for a lock, carries on down the chain, up to lock_donate_depth
+   holders in all.  Each step costs O(log n), where n is the
+   number of waiters or held locks involved.  Interrupts must be
+   off. */
+static void
+donate (struct lock *lock) 
+{
+  int depth;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (depth = 0; ; depth++)
+    {
+      struct thread *holder = lock->holder;
+      int priority = waiters_priority (&lock->semaphore);
+
+      /* Stop at the depth limit before touching the lock, so
+         that its key still matches its holder's priority. */
+      if (holder == NULL || priority == lock->priority
+          || depth >= lock_donate_depth)
+        return;
+
+      /* The lock's key in its holder's heap changes. */
+      pheap_remove (&holder->held_locks, &lock->holder_elem);
+      lock->priority = priority;
+      pheap_push (&holder->held_locks, &lock->holder_elem);
+
+      /* Changing the holder's priority also moves it within the
+         wait queue of the lock it waits for, if any. */
+      if (!update_priority (holder))
+        return;
+      trace_event (TRACE_DONATE, holder->tid, holder->priority);
+      lock = holder->waiting_lock;
+      if (lock == NULL)
+        return;
+    }
+}
+
+/* Recomputes T's effective priority as the higher of its base
+   priority and the priorities donated to it.  Returns true if it
+   changed, false otherwise.  Interrupts must be off. */
+static bool
+update_priority (struct thread *t) 
+{
+  int donated = lock_donated_priority (t);
+  int priority = t->base_priority > donated ? t->base_priority : donated;
+
+  if (priority == t->priority)
+    return false;
+  thread_change_priority (t, priority);
+  return true;
+}
+
+/* Returns the priority of SEMA's highest-priority waiter, or
+   PRI_MIN - 1 if it has none. */
+static int
+waiters_priority (const struct semaphore *sema) 
+{
+  struct pheap_elem *top = pheap_top (&sema->waiters);
+
+  return (top != NULL
+          ? pheap_entry (top, struct thread, wait_elem)->priority
+          : PRI_MIN - 1);
+}
+
+/* Orders the locks that a thread holds from highest to lowest
+   donated priority. */
+static bool
+lock_more (const struct pheap_elem *a_, const struct pheap_elem *b_,
+           void *aux UNUSED) 
 {
-  struct list_elem elem;              /* List element. */
-  struct semaphore semaphore;         /* This semaphore. */
-  int priority;
-};
+  const struct lock *a = pheap_entry (a_, struct lock, holder_elem);
+  const struct lock *b = pheap_entry (b_, struct lock, holder_elem);
+  return a->priority > b->priority;
+}
 
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
@@ -390,7 +436,7 @@ cond_init (struct condition *cond)
 {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  wait_queue_init (&cond->waiters);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -413,36 +459,34 @@ cond_init (struct condition *cond)
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
    we need to sleep. */
-static bool 
-sort_cond_by_priority (const struct list_elem *a_, const struct list_elem *b_,
-                      void *aux UNUSED) 
-{
-  const struct semaphore_elem *a = list_entry (a_, struct semaphore_elem, elem);
-  const struct semaphore_elem *b = list_entry (b_, struct semaphore_elem, elem);
-  return a->priority > b->priority; 
-}
-
 void
 cond_wait (struct condition *cond, struct lock *lock) 
 {
-  struct semaphore_elem waiter;
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
-  
-  sema_init (&waiter.semaphore, 0);
-  waiter.priority = thread_current()->priority;
-  list_insert_ordered (&cond->waiters, &waiter.elem, sort_cond_by_priority, NULL);
+
+  /* Releasing LOCK may let a higher-priority thread run and
+     signal COND before we get to block, in which case it has
+     already taken us off COND's wait queue. */
+  old_level = intr_disable ();
+  wait_queue_push (&cond->waiters, cur);
   lock_release (lock);
-  sema_down (&waiter.semaphore);
+  if (cur->wait_queue != NULL)
+    thread_block ();
+  intr_set_level (old_level);
+
   lock_acquire (lock);
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
-   this function signals one of them to wake up from its wait.
-   LOCK must be held before calling this function.
+   this function signals the highest-priority one of them to wake
+   up from its wait.  LOCK must be held before calling this
+   function.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
@@ -450,14 +494,17 @@ cond_wait (struct condition *cond, struct lock *lock)
 void
 cond_signal (struct condition *cond, struct lock *lock UNUSED) 
 {
+  enum intr_level old_level;
+
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
-  if (!list_empty (&cond->waiters)) 
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+  old_level = intr_disable ();
+  if (!pheap_empty (&cond->waiters)) 
+    wake_up (wait_queue_pop (&cond->waiters));
+  intr_set_level (old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -472,6 +519,81 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
 
-  while (!list_empty (&cond->waiters))
+  while (!pheap_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Wait queues.
+
+   Semaphores and condition variables keep their waiting threads
+   in a pairing heap ordered by priority, so that waking up the
+   highest-priority waiter does not require a scan.  A thread
+   records the queue it is in, so that thread_change_priority()
+   can move it when donation changes its priority. */
+
+/* Initializes Q as an empty wait queue. */
+static void
+wait_queue_init (struct pheap *q) 
+{
+  pheap_init (q, waiter_more, NULL);
+}
+
+/* Adds T to wait queue Q.  Interrupts must be off. */
+static void
+wait_queue_push (struct pheap *q, struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->wait_queue == NULL);
+
+  t->wait_queue = q;
+  t->wait_seq = wait_seq++;
+  pheap_push (q, &t->wait_elem);
+}
+
+/* Removes and returns the highest-priority thread in wait queue
+   Q, which must not be empty.  Interrupts must be off. */
+static struct thread *
+wait_queue_pop (struct pheap *q) 
+{
+  struct thread *t;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t = pheap_entry (pheap_pop (q), struct thread, wait_elem);
+  t->wait_queue = NULL;
+  return t;
+}
+
+/* Makes T, just taken off a wait queue, ready to run if it has
+   blocked, and arranges to yield to it if it should run ahead of
+   the running thread.  T may not have blocked yet
+   if cond_wait() was preempted before it could. */
+static void
+wake_up (struct thread *t) 
+{
+  if (t->status == THREAD_BLOCKED)
+    thread_unblock (t);
+
+  if (thread_preempts (t))
+    {
+      if (intr_context ())
+        intr_yield_on_return ();
+      else
+        thread_preempt ();
+    }
+}
+
+/* Orders waiting threads from highest to lowest priority, and
+   threads of equal priority in the order that they started
+   waiting.  The pairing heap is not stable, so the tie has to be
+   broken explicitly. */
+static bool
+waiter_more (const struct pheap_elem *a_, const struct pheap_elem *b_,
+             void *aux UNUSED) 
+{
+  const struct thread *a = pheap_entry (a_, struct thread, wait_elem);
+  const struct thread *b = pheap_entry (b_, struct thread, wait_elem);
+  if (a->priority != b->priority)
+    return a->priority > b->priority;
+  return (int) (a->wait_seq - b->wait_seq) < 0;
+}
@@ -2,13 +2,16 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <pheap.h>
 #include <stdbool.h>
 
+struct thread;
+
 /* A counting semaphore. */
 struct semaphore 
 {
   unsigned value;             /* Current value. */
-  struct list waiters;        /* List of waiting threads. */
+  struct pheap waiters;       /* Waiting threads, by priority. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -22,22 +25,26 @@ struct lock
 {
   struct thread *holder;      /* Thread holding lock (for debugging). */
   struct semaphore semaphore; /* Binary semaphore controlling access. */
-  struct list_elem elem;
+  int priority;               /* Highest waiter's priority. */
+  struct pheap_elem holder_elem; /* Element in holder's `held_locks'. */
 };
 
+/* Maximum length of a chain of priority donations. */
+extern int lock_donate_depth;
+
 void lock_init (struct lock *);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
-void priority_donation(struct lock *lock);
-int priority_restoration(struct lock *);
+void lock_init_holder (struct thread *);
+int lock_donated_priority (const struct thread *);
 
 /* Condition variable. */
 struct condition 
 {
-  struct list waiters;        /* List of waiting threads. */
+  struct pheap waiters;       /* Waiting threads, by priority. */
 };
 
 void cond_init (struct condition *);
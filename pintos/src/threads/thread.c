@@ -4,13 +4,18 @@
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
+#include "threads/fixed-point.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/smp.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -20,20 +25,83 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Run queue: one FIFO list of THREAD_READY threads per
+   priority level, plus a bitmap in which bit P is set if and
+   only if ready_queues[P] or boost_queues[P] is nonempty.
+   Together they let us insert a thread and find the
+   highest-priority ready thread in constant time, independent of
+   the number of ready threads.
+
+   A thread that becomes ready after blocking goes into the boost
+   queue for its priority instead, if thread_wake_boost is true.
+   Boosted threads run ahead of the other threads at their
+   priority, which favors threads that mostly wait for I/O or
+   semaphores over CPU-bound ones, without changing priorities.
+   A thread keeps what is left of its time slice across a block,
+   and is boosted only while some of it remains, so threads that
+   keep waking each other up cannot shut the others out. */
+static struct list ready_queues[PRI_MAX + 1];
+static struct list boost_queues[PRI_MAX + 1];
+static uint64_t ready_bitmap;
+static int ready_cnt;           /* # of threads in ready_queues. */
+
+/* Stride scheduling run queue, used instead of ready_queues when
+   thread_stride is true.  Ready threads are kept in a pairing
+   heap ordered by pass value, so the thread with the least pass
+   is chosen in O(log n) time.  A running thread's pass advances
+   by its stride on every tick, and its stride is inversely
+   proportional to its tickets, so over time each thread runs in
+   proportion to its tickets.
+
+   stride_global_pass is the pass of the thread most recently
+   chosen to run.  A thread that becomes ready after blocking is
+   brought forward to it, so that time spent blocked does not
+   build up credit that would let it monopolize the CPU. */
+#define STRIDE1 (1 << 20)       /* Stride of a thread with 1 ticket. */
+static struct pheap stride_queue;
+static int64_t stride_global_pass;
+
+/* Deadline run queue.  Ready deadline threads are kept in a
+   pairing heap ordered by absolute deadline, and always run ahead
+   of every other thread, earliest deadline first, whatever the
+   scheduler in use for the others.
+
+   Admission control keeps the deadline threads' total density,
+   the sum of runtime/deadline, at or below DL_BW_MAX.  This
+   guarantees that EDF can meet every deadline and leaves the
+   rest of the CPU to everyone else.  Densities are fractions of
+   DL_BW_UNIT. */
+#define DL_BW_UNIT (1 << 20)
+#define DL_BW_MAX (DL_BW_UNIT / 100 * 95)
+static struct pheap dl_queue;
+static int64_t dl_bw_total;     /* Total density of deadline threads. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
-/* Idle thread. */
-static struct thread *idle_thread;
-
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
+/* Cache of pages of threads that have exited, ready to be
+   reused by thread_create() without going back to the page
+   allocator.  The pages are kept in a stack linked through
+   their first word, most recently freed on top, since that page
+   is the most likely to still be in the CPU cache.  At most
+   thread_cache_limit pages are kept.  Accessed with interrupts
+   off. */
+struct cached_page
+  {
+    struct cached_page *next;   /* Next page in the cache. */
+  };
+static struct cached_page *thread_cache;
+static unsigned thread_cache_cnt;
+static unsigned thread_cache_hits;  /* # of pages reused from it. */
+
+/* Maximum number of pages in the thread page cache.
+   Controlled by kernel command-line option "-thread-cache". */
+unsigned thread_cache_limit = 32;
+
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
@@ -50,18 +118,55 @@ static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
 
-/* Scheduling. */
-#define TIME_SLICE 4            /* # of timer ticks to give each thread. */
-static unsigned thread_ticks;   /* # of timer ticks since last yield. */
+/* Scheduling.  Each CPU counts the ticks since its running
+   thread was scheduled in its struct cpu's `thread_ticks'. */
+#define TIME_SLICE 4            /* Initial # of timer ticks per slice. */
+
+/* Adaptive time slices.  A thread that uses up its whole slice
+   looks CPU-bound, so its slice is doubled, cutting down on
+   context switches.  A thread that blocks before its slice is up
+   looks I/O-bound, so its slice is halved, down to
+   thread_slice_min.  The longest slice allowed shrinks linearly
+   from thread_slice_max at PRI_MIN to TIME_SLICE at PRI_MAX,
+   because high-priority threads hold up everyone below them.
+   Controlled by kernel command-line options "-slice-min" and
+   "-slice-max". */
+unsigned thread_slice_min = 2;
+unsigned thread_slice_max = 16;
+
+/* If true (default), threads that wake up from blocking run
+   ahead of the other ready threads at their priority.
+   Cleared by kernel command-line option "-no-wake-boost". */
+bool thread_wake_boost = true;
+
+/* Context switch statistics. */
+static long long vol_switches;    /* # of times threads blocked or yielded. */
+static long long invol_switches;  /* # of times threads were preempted. */
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If false (default), choose threads by priority.
+   If true, use the stride scheduler.
+   Controlled by kernel command-line option "-stride". */
+bool thread_stride;
+
+/* Multi-level feedback queue scheduling.  Priorities are
+   recomputed every MLFQS_PRIORITY_TICKS ticks, and load_avg and
+   every thread's recent_cpu once per second.  Decaying every
+   thread's recent_cpu is left to a softirq, mlfqs_decay_work, so
+   that it does not lengthen the timer interrupt. */
+#define MLFQS_PRIORITY_TICKS 4
+static fixed_t load_avg;        /* System load average. */
+static fixed_t decay_coef;      /* recent_cpu decay for this second. */
+static struct work mlfqs_decay_work;
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
+static bool is_idle (const struct thread *);
 static struct thread *running_thread (void);
 static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
@@ -70,6 +175,28 @@ static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static struct thread *thread_page_get (void);
+static void thread_page_put (struct thread *);
+static void ready_queue_push (struct thread *);
+static void ready_queue_remove (struct thread *);
+static int ready_queue_max_priority (void);
+static void yield (bool preempted);
+static void slice_grow (struct thread *);
+static void slice_shrink (struct thread *);
+static pheap_less_func pass_less;
+static pheap_less_func deadline_less;
+static tid_t create_thread (const char *name, int priority,
+                            thread_func *, void *aux,
+                            int64_t runtime, int64_t period,
+                            int64_t deadline);
+static int64_t deadline_bw (int64_t runtime, int64_t deadline);
+static void deadline_replenish (struct thread *);
+static void deadline_throttle (struct thread *);
+static void mlfqs_tick (struct thread *);
+static void mlfqs_update_priority (struct thread *);
+static void mlfqs_update_recent_cpu (struct thread *, void *coef_);
+static void mlfqs_update_second (void);
+static void mlfqs_decay (struct work *);
 
 
 /* Initializes the threading system by transforming the code
@@ -88,10 +215,24 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  for (i = PRI_MIN; i <= PRI_MAX; i++)
+    {
+      list_init (&ready_queues[i]);
+      list_init (&boost_queues[i]);
+    }
+  ready_bitmap = 0;
+  ready_cnt = 0;
+  pheap_init (&stride_queue, pass_less, NULL);
+  stride_global_pass = 0;
+  pheap_init (&dl_queue, deadline_less, NULL);
+  dl_bw_total = 0;
+  load_avg = fp_from_int (0);
+  work_init (&mlfqs_decay_work, mlfqs_decay);
   list_init (&all_list);
 
   /* Set up a thread structure for the running thread. */
@@ -99,6 +240,7 @@ thread_init (void)
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid ();
+  initial_thread->cpu = cpu_current ();
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -114,10 +256,50 @@ thread_start (void)
   /* Start preemptive thread scheduling. */
   intr_enable ();
 
-  /* Wait for the idle thread to initialize idle_thread. */
+  /* Wait for the idle thread to make itself the CPU's idle
+     thread. */
   sema_down (&idle_started);
 }
 
+/* Creates the idle thread for application processor C, where it
+   will run first: C's startup code switches to the top of the
+   new thread's stack and calls thread_start_ap().  Returns the
+   new thread, or a null pointer if no page is available. */
+struct thread *
+thread_create_idle (struct cpu *c) 
+{
+  struct thread *t;
+  char name[16];
+
+  t = thread_page_get ();
+  if (t == NULL)
+    return NULL;
+
+  snprintf (name, sizeof name, "idle%d", c->id);
+  init_thread (t, name, PRI_MIN);
+  t->tid = allocate_tid ();
+  t->cpu = c;
+  c->idle_thread = t;
+  return t;
+}
+
+/* Starts scheduling threads on an application processor.
+   Called by the AP, with interrupts off, on the stack of the idle
+   thread that thread_create_idle() made for it, which becomes the
+   running thread. */
+void
+thread_start_ap (void) 
+{
+  struct thread *t = running_thread ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t == t->cpu->idle_thread);
+
+  t->status = THREAD_RUNNING;
+  idle (NULL);
+  NOT_REACHED ();
+}
+
 /* Called by the timer interrupt handler at each timer tick.
    Thus, this function runs in an external interrupt context. */
 void
@@ -126,7 +308,7 @@ thread_tick (void)
   struct thread *t = thread_current ();
 
   /* Update statistics. */
-  if (t == idle_thread)
+  if (is_idle (t))
     idle_ticks++;
 #ifdef USERPROG
   else if (t->pagedir != NULL)
@@ -135,17 +317,55 @@ thread_tick (void)
   else
     kernel_ticks++;
 
-  /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  if (thread_mlfqs)
+    mlfqs_tick (t);
+  else if (thread_stride && !is_idle (t))
+    t->pass += t->stride;
+
+  /* A deadline thread that has used up its runtime is throttled
+     until its next period, when thread_yield() is called on
+     return from the interrupt. */
+  if (t->dl_runtime > 0 && --t->dl_budget <= 0)
     intr_yield_on_return ();
+
+  /* Enforce preemption. */
+  if (++t->cpu->thread_ticks >= t->time_slice)
+    {
+      slice_grow (t);
+      intr_yield_on_return ();
+    }
+}
+
+/* Accounts for CNT timer ticks that passed while the CPU was
+   idle with the periodic timer interrupt stopped (see
+   timer_idle_enter()).  Interrupts must be off. */
+void
+thread_tick_idle (int64_t cnt) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  idle_ticks += cnt;
 }
 
-/* Prints thread statistics. */
+/* Prints thread statistics, followed by the context switch
+   counts of each thread that is still alive. */
 void
 thread_print_stats (void) 
 {
+  struct list_elem *e;
+
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  printf ("Thread: %lld voluntary switches, %lld involuntary switches\n",
+          vol_switches, invol_switches);
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, allelem);
+      printf ("Thread %s (tid %d): %u voluntary, %u involuntary, "
+              "%u-tick slice\n", t->name, t->tid, t->vol_switches,
+              t->invol_switches, t->time_slice);
+    }
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -166,24 +386,91 @@ thread_print_stats (void)
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux) 
+{
+  return create_thread (name, priority, function, aux, 0, 0, 0);
+}
+
+/* Creates a deadline thread named NAME, which executes FUNCTION
+   passing AUX as the argument, like thread_create().  Each
+   PERIOD ticks, the thread may run for up to RUNTIME ticks, and
+   must get them within DEADLINE ticks of the start of the
+   period.  The thread should call thread_deadline_yield() when
+   it has finished its work for a period.  If it runs for
+   RUNTIME ticks first, it is throttled until the next period.
+
+   Deadline threads run ahead of all other threads, earliest
+   deadline first.  Returns the new thread's identifier, or
+   TID_ERROR if creation fails or if admitting the thread would
+   leave the deadline threads unable to meet their deadlines. */
+tid_t
+thread_create_deadline (const char *name, int64_t runtime,
+                        int64_t period, int64_t deadline,
+                        thread_func *function, void *aux) 
+{
+  enum intr_level old_level;
+  int64_t bw;
+  tid_t tid;
+
+  ASSERT (0 < runtime && runtime <= deadline && deadline <= period);
+
+  /* Admission control. */
+  bw = deadline_bw (runtime, deadline);
+  old_level = intr_disable ();
+  if (dl_bw_total + bw > DL_BW_MAX)
+    {
+      intr_set_level (old_level);
+      return TID_ERROR;
+    }
+  dl_bw_total += bw;
+  intr_set_level (old_level);
+
+  tid = create_thread (name, PRI_MAX, function, aux,
+                       runtime, period, deadline);
+  if (tid == TID_ERROR)
+    {
+      old_level = intr_disable ();
+      dl_bw_total -= bw;
+      intr_set_level (old_level);
+    }
+  return tid;
+}
+
+/* Does the work of thread_create() and thread_create_deadline().
+   RUNTIME is 0 for a thread that is not a deadline thread. */
+static tid_t
+create_thread (const char *name, int priority,
+               thread_func *function, void *aux,
+               int64_t runtime, int64_t period, int64_t deadline) 
 {
   struct thread *t;
   struct kernel_thread_frame *kf;
   struct switch_entry_frame *ef;
   struct switch_threads_frame *sf;
   tid_t tid;
+  bool preempt;
   enum intr_level old_level;
 
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = thread_page_get ();
   if (t == NULL)
     return TID_ERROR;
 
-  /* Initialize thread. */
+  /* Initialize thread.  A deadline thread's first period starts
+     now. */
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
+  trace_thread_name (tid, name);
+  if (runtime > 0)
+    {
+      t->dl_runtime = runtime;
+      t->dl_period = period;
+      t->dl_deadline = deadline;
+      t->dl_period_start = timer_ticks ();
+      t->dl_abs_deadline = t->dl_period_start + deadline;
+      t->dl_budget = runtime;
+    }
 
   /* Prepare thread for first run by initializing its stack.
      Do this atomically so intermediate values for the 'stack' 
@@ -210,29 +497,16 @@ thread_create (const char *name, int priority,
 
   intr_set_level (old_level);
 
-  /* Add to run queue. */
+  /* Add to run queue, and yield to T if it should run first.
+     T may run and exit as soon as interrupts are enabled, so
+     decide that before. */
+  old_level = intr_disable ();
   thread_unblock (t);
-/*
-  if (!list_empty(&ready_list))
-  {
-    printf("\nready list from create = (");
-    struct list_elem *e = list_begin(&ready_list);
-    for (e; e != list_end(&ready_list); e = list_next(e))
-    {
-      printf(" %s ", list_entry(e, struct thread, elem)->name);
-    }
-    printf(")\n");
-  }
-*/
-  /* TEST : priority-preempt */
-  /* Yields CPU to the first thread in ready_list */
-  /* if the priority of new thread is higher than it of running thread. */
-  struct thread *cur_t = thread_current();
-  if (cur_t->priority < priority)
-  {
-    //printf("yield, (%s, %d) to (%s, %d)\n", cur_t->name, cur_t->priority, name, priority);
-    thread_yield();
-  }
+  preempt = thread_preempts (t);
+  intr_set_level (old_level);
+
+  if (preempt)
+    thread_preempt ();
 
   return tid;
 }
@@ -251,20 +525,31 @@ thread_block (void)
   ASSERT (intr_get_level () == INTR_OFF);
 
   struct thread * t = thread_current();
+  unsigned ticks = t->cpu->thread_ticks;
 
+  if (!is_idle (t))
+    {
+      if (ticks < t->time_slice)
+        slice_shrink (t);
+      t->vol_switches++;
+      vol_switches++;
+
+      /* Carry the part of the slice already used over to when we
+         run again.  Once it is all used up, we start over with a
+         fresh slice but forfeit the wakeup boost. */
+      if (ticks < t->time_slice)
+        {
+          t->slice_used = ticks;
+          t->woken = true;
+        }
+      else
+        t->slice_used = 0;
+    }
   t->status = THREAD_BLOCKED;
+  trace_event (TRACE_BLOCK, t->tid, t->priority);
   schedule ();
 }
 
-static bool 
-sort_by_priority (const struct list_elem *a_, const struct list_elem *b_,
-                      void *aux UNUSED) 
-{
-  const struct thread *a = list_entry (a_, struct thread, elem);
-  const struct thread *b = list_entry (b_, struct thread, elem);
-  return a->priority > b->priority; 
-}
-
 /* Transitions a blocked thread T to the ready-to-run state.
    This is an error if T is not blocked.  (Use thread_yield() to
    make the running thread ready.)
@@ -282,9 +567,14 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
-  list_sort(&ready_list, sort_by_priority, NULL);
+  if (thread_stride && t->pass < stride_global_pass)
+    t->pass = stride_global_pass;
+  if (t->dl_runtime > 0)
+    deadline_replenish (t);
+  ready_queue_push (t);
   t->status = THREAD_READY;
+  trace_event (TRACE_WAKEUP, t->tid, t->priority);
+  smp_wake_idle ();
 
   intr_set_level (old_level);
 }
@@ -337,23 +627,36 @@ thread_exit (void)
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
   intr_disable ();
+  if (thread_current ()->dl_runtime > 0)
+    dl_bw_total -= deadline_bw (thread_current ()->dl_runtime,
+                                thread_current ()->dl_deadline);
   list_remove (&thread_current()->allelem);
   thread_current ()->status = THREAD_DYING;
   schedule ();
   NOT_REACHED ();
 }
-static bool
-insert_by_priority(const struct list_elem *e1, const struct list_elem *e2, void *aux UNUSED)
-{
-  const struct thread *t1 = list_entry(e1, struct thread, elem);
-  const struct thread *t2 = list_entry(e2, struct thread, elem);
 
-  return t1->priority > t2->priority;
-}
 /* Yields the CPU.  The current thread is not put to sleep and
    may be scheduled again immediately at the scheduler's whim. */
 void
 thread_yield (void) 
+{
+  yield (false);
+}
+
+/* Yields the CPU on behalf of the scheduler, because the current
+   thread's time slice is up or a thread that should run ahead of
+   it has become ready.  Like thread_yield(), but counted as an
+   involuntary context switch. */
+void
+thread_preempt (void) 
+{
+  yield (true);
+}
+
+/* Does the work of thread_yield() and thread_preempt(). */
+static void
+yield (bool preempted) 
 {
   struct thread *cur = thread_current ();
   enum intr_level old_level;
@@ -361,15 +664,68 @@ thread_yield (void)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  if (cur != idle_thread)
-  {
-    //list_insert_ordered(&ready_list, &cur->elem, insert_by_priority, NULL);
-    list_push_back (&ready_list, &cur->elem);
-    list_sort(&ready_list, sort_by_priority, NULL);
-  }
-  cur->status = THREAD_READY;
-  schedule ();
+  if (!is_idle (cur))
+    {
+      if (preempted)
+        {
+          cur->invol_switches++;
+          invol_switches++;
+        }
+      else
+        {
+          cur->vol_switches++;
+          vol_switches++;
+        }
+    }
+  if (cur->dl_runtime > 0 && cur->dl_budget <= 0)
+    deadline_throttle (cur);
+  else
+    {
+      if (!is_idle (cur))
+        ready_queue_push (cur);
+      cur->status = THREAD_READY;
+      schedule ();
+    }
+  intr_set_level (old_level);
+}
+
+/* Ends the running deadline thread's work for its current
+   period, and waits for the next period, when it will get a
+   fresh runtime budget and deadline.  Returns true if the work
+   was finished by the deadline, false if the deadline was
+   missed. */
+bool
+thread_deadline_yield (void) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  bool met;
+
+  ASSERT (!intr_context ());
+  ASSERT (cur->dl_runtime > 0);
+
+  old_level = intr_disable ();
+  met = timer_ticks () <= cur->dl_abs_deadline;
+  cur->dl_budget = 0;
+  deadline_throttle (cur);
   intr_set_level (old_level);
+
+  return met;
+}
+
+/* Returns true if T, a ready thread, should run ahead of the
+   running thread.  Deadline threads come first, earliest
+   deadline first, and then other threads by priority. */
+bool
+thread_preempts (const struct thread *t) 
+{
+  const struct thread *cur = thread_current ();
+
+  if (t->dl_runtime > 0 || cur->dl_runtime > 0)
+    return (t->dl_runtime > 0
+            && (cur->dl_runtime == 0
+                || t->dl_abs_deadline < cur->dl_abs_deadline));
+  return t->priority > cur->priority;
 }
 
 /* Invoke function 'func' on all threads, passing along 'aux'.
@@ -389,22 +745,67 @@ thread_foreach (thread_action_func *func, void *aux)
     }
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Sets the current thread's base priority to NEW_PRIORITY.  Its
+   effective priority is the higher of that and any priority
+   donated to it through the locks it holds. */
 void
 thread_set_priority (int new_priority) 
 {
   struct thread *ct = thread_current ();
+  enum intr_level old_level;
+  int donated_priority;
+  int max_priority;
 
-  if (ct->donation_nested_level == 0)
-    ct->priority = new_priority;
+  ASSERT (PRI_MIN <= new_priority && new_priority <= PRI_MAX);
 
-  ct->orig_priority = new_priority;
+  /* The MLFQS computes priorities itself. */
+  if (thread_mlfqs)
+    return;
 
-  /* TEST : priority-change */
-  struct thread *t = list_entry(list_begin(&ready_list), struct thread, elem);
-  
-  if (new_priority < t->priority)
-    thread_yield();
+  /* A donated priority stays in effect until the lock through
+     which it was donated is released. */
+  old_level = intr_disable ();
+  ct->base_priority = new_priority;
+  donated_priority = lock_donated_priority (ct);
+  thread_change_priority (ct, new_priority > donated_priority
+                              ? new_priority : donated_priority);
+  max_priority = ready_queue_max_priority ();
+  intr_set_level (old_level);
+
+  if (ct->priority < max_priority)
+    thread_yield ();
+}
+
+/* Changes the priority of thread T to PRIORITY, for use when T's
+   priority is raised or lowered by donation.  If T is in the run
+   queue, it is moved to the queue for its new priority, so that
+   next_thread_to_run() keeps choosing the right thread.
+   Likewise, if T is in a semaphore's or condition variable's
+   wait queue, it is moved to its new place there. */
+void
+thread_change_priority (struct thread *t, int priority)
+{
+  enum intr_level old_level;
+
+  ASSERT (is_thread (t));
+  ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+  old_level = intr_disable ();
+  if (t->priority != priority)
+    {
+      if (t->status == THREAD_READY)
+        ready_queue_remove (t);
+      if (t->wait_queue != NULL)
+        pheap_remove (t->wait_queue, &t->wait_elem);
+
+      t->priority = priority;
+
+      if (t->status == THREAD_READY)
+        ready_queue_push (t);
+      if (t->wait_queue != NULL)
+        pheap_push (t->wait_queue, &t->wait_elem);
+    }
+  intr_set_level (old_level);
 }
 
 /* Returns the current thread's priority. */
@@ -414,52 +815,288 @@ thread_get_priority (void)
   return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE and recomputes
+   its priority, yielding if it no longer has the highest
+   priority. */
 void
-thread_set_nice (int nice UNUSED) 
+thread_set_nice (int nice) 
 {
-  /* Not yet implemented. */
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  bool yield;
+
+  ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+  old_level = intr_disable ();
+  cur->nice = nice;
+  if (thread_mlfqs)
+    mlfqs_update_priority (cur);
+  yield = ready_queue_max_priority () > cur->priority;
+  intr_set_level (old_level);
+
+  if (yield)
+    thread_yield ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load_avg_100 = fp_to_int_round (fp_mul_int (load_avg, 100));
+  intr_set_level (old_level);
+
+  return load_avg_100;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int recent_cpu_100 = 
+    fp_to_int_round (fp_mul_int (thread_current ()->recent_cpu, 100));
+  intr_set_level (old_level);
+
+  return recent_cpu_100;
+}
+
+/* Sets the current thread's tickets to TICKETS.  Under the
+   stride scheduler, the thread's share of the CPU from now on is
+   proportional to TICKETS; the pass it has already accumulated
+   is kept. */
+void
+thread_set_tickets (int tickets) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (TICKETS_MIN <= tickets && tickets <= TICKETS_MAX);
+
+  old_level = intr_disable ();
+  cur->tickets = tickets;
+  cur->stride = STRIDE1 / tickets;
+  intr_set_level (old_level);
+}
+
+/* Returns the current thread's tickets. */
+int
+thread_get_tickets (void) 
+{
+  return thread_current ()->tickets;
+}
+
+/* Returns the density of a deadline thread that may run for
+   RUNTIME ticks within DEADLINE ticks, as a fraction of
+   DL_BW_UNIT. */
+static int64_t
+deadline_bw (int64_t runtime, int64_t deadline) 
+{
+  return runtime * DL_BW_UNIT / deadline;
+}
+
+/* Starts a new period for deadline thread T, which is about to
+   become ready, if its current period is over.  A thread that
+   wakes up late starts its new period when it wakes, so that it
+   is not handed a deadline that has already passed. */
+static void
+deadline_replenish (struct thread *t) 
+{
+  int64_t now = timer_ticks ();
+
+  if (now >= t->dl_period_start + t->dl_period)
+    {
+      t->dl_period_start = now;
+      t->dl_abs_deadline = now + t->dl_deadline;
+      t->dl_budget = t->dl_runtime;
+    }
+}
+
+/* Blocks deadline thread T, the running thread, which is out of
+   runtime budget, until its next period starts.  If that has
+   already happened, starts the new period at once and just
+   yields.  Interrupts must be off. */
+static void
+deadline_throttle (struct thread *t) 
+{
+  int64_t next_period = t->dl_period_start + t->dl_period;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (next_period > timer_ticks ())
+    timer_throttle (next_period);
+  else
+    {
+      deadline_replenish (t);
+      ready_queue_push (t);
+      t->status = THREAD_READY;
+      schedule ();
+    }
+}
+
+/* Multi-level feedback queue bookkeeping for one timer tick,
+   with T the running thread.
+
+   Only the running thread's recent_cpu changes from tick to
+   tick, so only its priority can change between the
+   once-per-second updates.  Recomputing just that one priority
+   keeps the work done in the interrupt handler independent of
+   the number of threads.  The update at each second boundary,
+   which visits every thread, runs as a softirq with interrupts
+   on.  Only the BSP, whose ticks are the ones that
+   timer_ticks() counts, does that update. */
+static void
+mlfqs_tick (struct thread *t) 
+{
+  int64_t ticks = timer_ticks ();
+
+  ASSERT (intr_context ());
+
+  if (!is_idle (t))
+    t->recent_cpu = fp_add_int (t->recent_cpu, 1);
+
+  if (ticks % TIMER_FREQ == 0 && t->cpu->id == 0)
+    mlfqs_update_second ();
+  else if (ticks % MLFQS_PRIORITY_TICKS == 0 && !is_idle (t))
+    mlfqs_update_priority (t);
+
+  if (ready_queue_max_priority () > t->priority)
+    intr_yield_on_return ();
+}
+
+/* Recomputes T's priority from its recent_cpu and nice values:
+   priority = PRI_MAX - (recent_cpu / 4) - (nice * 2),
+   clamped to the range PRI_MIN...PRI_MAX. */
+static void
+mlfqs_update_priority (struct thread *t) 
+{
+  int priority = PRI_MAX - fp_to_int (fp_div_int (t->recent_cpu, 4))
+                 - t->nice * 2;
+
+  if (priority < PRI_MIN)
+    priority = PRI_MIN;
+  else if (priority > PRI_MAX)
+    priority = PRI_MAX;
+
+  if (priority != t->priority)
+    thread_change_priority (t, priority);
+}
+
+/* Decays T's recent_cpu by the fixed-point coefficient that
+   COEF_ points to, then recomputes its priority.  The idle
+   thread is left alone. */
+static void
+mlfqs_update_recent_cpu (struct thread *t, void *coef_) 
+{
+  fixed_t *coef = coef_;
+
+  if (is_idle (t))
+    return;
+
+  t->recent_cpu = fp_add_int (fp_mul (*coef, t->recent_cpu), t->nice);
+  mlfqs_update_priority (t);
+}
+
+/* Once-per-second update of the load average and of every
+   thread's recent_cpu and priority:
+
+     load_avg = (59/60) * load_avg + (1/60) * ready_threads
+     recent_cpu = (2*load_avg)/(2*load_avg + 1) * recent_cpu + nice
+
+   The load average depends on the number of ready threads at
+   this moment, so it is updated here, in the timer interrupt.
+   The decay coefficient is the same for every thread, so it is
+   computed once, and applying it to every thread is deferred to
+   mlfqs_decay(). */
+static void
+mlfqs_update_second (void) 
+{
+  int ready_threads = ready_cnt;
+  fixed_t twice_load;
+
+  if (!is_idle (thread_current ()))
+    ready_threads++;
+
+  load_avg = fp_add (fp_div_int (fp_mul_int (load_avg, 59), 60),
+                     fp_div_int (fp_from_int (ready_threads), 60));
+
+  twice_load = fp_mul_int (load_avg, 2);
+  decay_coef = fp_div (twice_load, fp_add_int (twice_load, 1));
+  intr_defer (&mlfqs_decay_work);
+}
+
+/* Softirq that decays every thread's recent_cpu by decay_coef
+   and recomputes its priority, then yields if that leaves a
+   ready thread with a higher priority than the running one.
+
+   Interrupts are turned off only around each thread's update.
+   No thread can be created or exit on this CPU meanwhile,
+   because we are in interrupt context, so all_list stays put.
+   Another CPU could change it, though, so with more than one CPU
+   running, interrupts stay off for the whole walk. */
+static void
+mlfqs_decay (struct work *w UNUSED) 
+{
+  struct list_elem *e;
+  enum intr_level old_level;
+  bool yield;
+
+  if (smp_cpu_cnt () > 1)
+    {
+      old_level = intr_disable ();
+      thread_foreach (mlfqs_update_recent_cpu, &decay_coef);
+      intr_set_level (old_level);
+    }
+  else
+    for (e = list_begin (&all_list); e != list_end (&all_list);
+         e = list_next (e))
+      {
+        struct thread *t = list_entry (e, struct thread, allelem);
+
+        old_level = intr_disable ();
+        mlfqs_update_recent_cpu (t, &decay_coef);
+        intr_set_level (old_level);
+      }
+
+  old_level = intr_disable ();
+  yield = ready_queue_max_priority () > thread_current ()->priority;
+  intr_set_level (old_level);
+  if (yield)
+    intr_yield_on_return ();
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
+   Each CPU has its own.
 
-   The idle thread is initially put on the ready list by
+   The BSP's idle thread is initially put on the ready list by
    thread_start().  It will be scheduled once initially, at which
-   point it initializes idle_thread, "up"s the semaphore passed
-   to it to enable thread_start() to continue, and immediately
-   blocks.  After that, the idle thread never appears in the
-   ready list.  It is returned by next_thread_to_run() as a
-   special case when the ready list is empty. */
+   point it makes itself the CPU's idle thread, "up"s the
+   semaphore passed to it to enable thread_start() to continue,
+   and immediately blocks.  After that, the idle thread never
+   appears in the ready list.  It is returned by
+   next_thread_to_run() as a special case when the ready list is
+   empty.  An AP's idle thread is the first thread to run on it,
+   and calls this function with a null IDLE_STARTED_, from
+   thread_start_ap(). */
 static void
-idle (void *idle_started_ UNUSED) 
+idle (void *idle_started_) 
 {
   struct semaphore *idle_started = idle_started_;
-  idle_thread = thread_current ();
-  sema_up (idle_started);
+
+  if (idle_started != NULL)
+    {
+      intr_disable ();
+      running_thread ()->cpu->idle_thread = thread_current ();
+      intr_enable ();
+      sema_up (idle_started);
+    }
 
   for (;;) 
     {
@@ -467,19 +1104,12 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
-      /* Re-enable interrupts and wait for the next one.
+      /* In tickless mode, stop the periodic timer interrupt until
+         the next sleeper is due. */
+      timer_idle_enter ();
 
-         The `sti' instruction disables interrupts until the
-         completion of the next instruction, so these two
-         instructions are executed atomically.  This atomicity is
-         important; otherwise, an interrupt could be handled
-         between re-enabling interrupts and waiting for the next
-         one to occur, wasting as much as one clock tick worth of
-         time.
-
-         See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
-         7.11.1 "HLT Instruction". */
-      asm volatile ("sti; hlt" : : : "memory");
+      /* Re-enable interrupts and wait for the next one. */
+      intr_wait ();
     }
 }
 
@@ -515,11 +1145,21 @@ is_thread (struct thread *t)
   return t != NULL && t->magic == THREAD_MAGIC;
 }
 
+/* Returns true if T is a CPU's idle thread.  An idle thread only
+   ever runs on its own CPU. */
+static bool
+is_idle (const struct thread *t) 
+{
+  return t->cpu != NULL && t == t->cpu->idle_thread;
+}
+
 /* Does basic initialization of T as a blocked thread named
    NAME. */
 static void
 init_thread (struct thread *t, const char *name, int priority)
 {
+  enum intr_level old_level;
+
   ASSERT (t != NULL);
   ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
   ASSERT (name != NULL);
@@ -529,12 +1169,35 @@ init_thread (struct thread *t, const char *name, int priority)
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = priority;
-  t->orig_priority = priority;
+  t->base_priority = priority;
   t->magic = THREAD_MAGIC;
-  t->lock_waiting_for = NULL;
-  t->donation_nested_level = 0;
-  list_init(&t->lock_list);
+  t->waiting_lock = NULL;
+  lock_init_holder (t);
+
+  /* Under the MLFQS a new thread inherits its creator's nice and
+     recent_cpu values, and PRIORITY is ignored.  The initial
+     thread starts from zero. */
+  t->time_slice = TIME_SLICE;
+  t->nice = NICE_DEFAULT;
+  t->recent_cpu = fp_from_int (0);
+  t->tickets = TICKETS_DEFAULT;
+  t->stride = STRIDE1 / TICKETS_DEFAULT;
+  t->pass = stride_global_pass;
+  if (thread_mlfqs)
+    {
+      if (t != running_thread ())
+        {
+          struct thread *parent = running_thread ();
+          t->nice = parent->nice;
+          t->recent_cpu = parent->recent_cpu;
+        }
+      mlfqs_update_priority (t);
+      t->base_priority = t->priority;
+    }
+
+  old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
+  intr_set_level (old_level);
 }
 
 /* Allocates a SIZE-byte frame at the top of thread T's stack and
@@ -554,14 +1217,170 @@ alloc_frame (struct thread *t, size_t size)
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
    will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   the running CPU's idle thread.  All CPUs share the one run
+   queue; see smp.c. */
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
+  struct thread *idle_thread = running_thread ()->cpu->idle_thread;
+  struct thread *t;
+  int priority;
+
+  if (!pheap_empty (&dl_queue))
+    {
+      t = pheap_entry (pheap_pop (&dl_queue), struct thread, dl_elem);
+      ready_cnt--;
+      return t;
+    }
+
+  if (thread_stride)
+    {
+      if (pheap_empty (&stride_queue))
+        return idle_thread;
+      t = pheap_entry (pheap_pop (&stride_queue), struct thread, stride_elem);
+      stride_global_pass = t->pass;
+      ready_cnt--;
+      return t;
+    }
+
+  if (ready_bitmap == 0)
     return idle_thread;
+
+  priority = ready_queue_max_priority ();
+  if (!list_empty (&boost_queues[priority]))
+    t = list_entry (list_pop_front (&boost_queues[priority]),
+                    struct thread, elem);
   else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+    t = list_entry (list_pop_front (&ready_queues[priority]),
+                    struct thread, elem);
+  if (list_empty (&ready_queues[priority])
+      && list_empty (&boost_queues[priority]))
+    ready_bitmap &= ~((uint64_t) 1 << priority);
+  ready_cnt--;
+  return t;
+}
+
+/* Appends T to the run queue for its priority, or inserts it
+   into the deadline queue or, under the stride scheduler, the
+   stride queue.  Interrupts must be off. */
+static void
+ready_queue_push (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->dl_runtime > 0)
+    {
+      pheap_push (&dl_queue, &t->dl_elem);
+      ready_cnt++;
+      return;
+    }
+  if (thread_stride)
+    {
+      pheap_push (&stride_queue, &t->stride_elem);
+      ready_cnt++;
+      return;
+    }
+
+  if (t->woken && thread_wake_boost)
+    list_push_back (&boost_queues[t->priority], &t->elem);
+  else
+    list_push_back (&ready_queues[t->priority], &t->elem);
+  ready_bitmap |= (uint64_t) 1 << t->priority;
+  ready_cnt++;
+}
+
+/* Removes T from the run queue it is in.
+   Interrupts must be off. */
+static void
+ready_queue_remove (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->dl_runtime > 0)
+    {
+      pheap_remove (&dl_queue, &t->dl_elem);
+      ready_cnt--;
+      return;
+    }
+  if (thread_stride)
+    {
+      pheap_remove (&stride_queue, &t->stride_elem);
+      ready_cnt--;
+      return;
+    }
+
+  list_remove (&t->elem);
+  if (list_empty (&ready_queues[t->priority])
+      && list_empty (&boost_queues[t->priority]))
+    ready_bitmap &= ~((uint64_t) 1 << t->priority);
+  ready_cnt--;
+}
+
+/* Returns the highest priority among ready threads, or -1 if
+   no thread is ready.  Scans the bitmap with BSR, so this takes
+   constant time.  Interrupts must be off. */
+static int
+ready_queue_max_priority (void)
+{
+  uint32_t high = ready_bitmap >> 32;
+  uint32_t low = ready_bitmap;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (high != 0)
+    return 63 - __builtin_clz (high);
+  else if (low != 0)
+    return 31 - __builtin_clz (low);
+  else
+    return -1;
+}
+
+/* Doubles T's time slice, up to the longest slice allowed at
+   T's priority. */
+static void
+slice_grow (struct thread *t) 
+{
+  unsigned high = thread_slice_max < TIME_SLICE ? thread_slice_max : TIME_SLICE;
+  unsigned cap = thread_slice_max - (thread_slice_max - high)
+                                    * (t->priority - PRI_MIN)
+                                    / (PRI_MAX - PRI_MIN);
+
+  t->time_slice *= 2;
+  if (t->time_slice > cap)
+    t->time_slice = cap;
+  if (t->time_slice < 1)
+    t->time_slice = 1;
+}
+
+/* Halves T's time slice, down to thread_slice_min. */
+static void
+slice_shrink (struct thread *t) 
+{
+  t->time_slice /= 2;
+  if (t->time_slice < thread_slice_min)
+    t->time_slice = thread_slice_min;
+  if (t->time_slice < 1)
+    t->time_slice = 1;
+}
+
+/* Orders threads in the stride queue by pass value. */
+static bool
+pass_less (const struct pheap_elem *a_, const struct pheap_elem *b_,
+           void *aux UNUSED) 
+{
+  const struct thread *a = pheap_entry (a_, struct thread, stride_elem);
+  const struct thread *b = pheap_entry (b_, struct thread, stride_elem);
+  return a->pass < b->pass;
+}
+
+/* Orders threads in the deadline queue by absolute deadline. */
+static bool
+deadline_less (const struct pheap_elem *a_, const struct pheap_elem *b_,
+               void *aux UNUSED) 
+{
+  const struct thread *a = pheap_entry (a_, struct thread, dl_elem);
+  const struct thread *b = pheap_entry (b_, struct thread, dl_elem);
+  return a->dl_abs_deadline < b->dl_abs_deadline;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -587,11 +1406,14 @@ thread_schedule_tail (struct thread *prev)
   
   ASSERT (intr_get_level () == INTR_OFF);
 
-  /* Mark us as running. */
+  /* Mark us as running.  Any wakeup boost has now been used. */
   cur->status = THREAD_RUNNING;
+  cur->woken = false;
+  cur->cpu->idle = is_idle (cur);
 
-  /* Start new time slice. */
-  thread_ticks = 0;
+  /* Start a new time slice, or resume the one we blocked in. */
+  cur->cpu->thread_ticks = cur->slice_used;
+  cur->slice_used = 0;
 
 #ifdef USERPROG
   /* Activate the new address space. */
@@ -606,14 +1428,100 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      thread_page_put (prev);
     }
 }
 
+/* Returns a page for a new thread, from the thread page cache if
+   it is not empty, otherwise from the page allocator.  Returns a
+   null pointer if no page is available.
+
+   The page is not zeroed.  init_thread() zeroes the struct
+   thread at the bottom of the page, and the kernel stack above
+   it is always written before it is read. */
+static struct thread *
+thread_page_get (void) 
+{
+  struct cached_page *page;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  page = thread_cache;
+  if (page != NULL)
+    {
+      thread_cache = page->next;
+      thread_cache_cnt--;
+      thread_cache_hits++;
+    }
+  intr_set_level (old_level);
+
+  if (page == NULL)
+    page = palloc_get_page (0);
+  return (struct thread *) page;
+}
+
+/* Frees dead thread T's page, keeping it in the thread page
+   cache if there is room.  Interrupts must be off. */
+static void
+thread_page_put (struct thread *t) 
+{
+  struct cached_page *page = (struct cached_page *) t;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_cache_cnt >= thread_cache_limit)
+    {
+      palloc_free_page (t);
+      return;
+    }
+
+  /* Make sure is_thread() cannot mistake the page for a live
+     thread. */
+  t->magic = 0;
+  page->next = thread_cache;
+  thread_cache = page;
+  thread_cache_cnt++;
+}
+
+/* Returns the number of times thread_create() has reused a page
+   from the thread page cache. */
+unsigned
+thread_cache_hit_cnt (void) 
+{
+  return thread_cache_hits;
+}
+
+/* Returns every page in the thread page cache to the page
+   allocator, and returns the number of pages freed.  Called by
+   the page allocator when it runs out of kernel pages. */
+size_t
+thread_cache_reclaim (void) 
+{
+  struct cached_page *page;
+  enum intr_level old_level;
+  size_t cnt = 0;
+
+  old_level = intr_disable ();
+  page = thread_cache;
+  thread_cache = NULL;
+  thread_cache_cnt = 0;
+  intr_set_level (old_level);
+
+  while (page != NULL)
+    {
+      struct cached_page *next = page->next;
+      palloc_free_page (page);
+      page = next;
+      cnt++;
+    }
+  return cnt;
+}
+
 /* Schedules a new process.  At entry, interrupts must be off and
    the running process's state must have been changed from
    running to some other state.  This function finds another
-   thread to run and switches to it.
+   thread to run and switches to it.  The new thread runs on the
+   same CPU, so it takes over the running thread's `cpu'.
 
    It's not safe to call printf() until thread_schedule_tail()
    has completed. */
@@ -628,8 +1536,17 @@ schedule (void)
   ASSERT (cur->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
 
-  if (cur != next)
-    prev = switch_threads (cur, next);
+  /* If the idle thread stopped the timer tick, bring the tick
+     count up to date before anyone else runs. */
+  if (is_idle (cur))
+    timer_idle_exit ();
+
+  if (cur != next) 
+    {
+      next->cpu = cur->cpu;
+      trace_event (TRACE_SWITCH, next->tid, next->priority);
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
@@ -2,8 +2,13 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <heap.h>
 #include <list.h>
+#include <pheap.h>
 #include <stdint.h>
+#include "threads/fixed-point.h"
+
+struct cpu;
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -19,11 +24,26 @@ enum thread_status
 typedef int tid_t;
 #define TID_ERROR ((tid_t) -1)          /* Error value for tid_t. */
 
-/* Thread priorities. */
+/* Thread priorities.
+   thread.c keeps one run queue per priority and tracks the
+   nonempty ones in a 64-bit bitmap, so there may be at most 64
+   priority levels. */
 #define PRI_MIN 0                       /* Lowest priority. */
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness, used by the multi-level feedback queue
+   scheduler. */
+#define NICE_MIN -20                    /* Nicest to other threads. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice to other threads. */
+
+/* Thread tickets, used by the stride scheduler.  A thread's
+   share of the CPU is proportional to its tickets. */
+#define TICKETS_MIN 1                   /* Fewest tickets. */
+#define TICKETS_DEFAULT 100             /* Default tickets. */
+#define TICKETS_MAX 10000               /* Most tickets. */
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -74,12 +94,12 @@ typedef int tid_t;
    the `magic' member of the running thread's `struct thread' is
    set to THREAD_MAGIC.  Stack overflow will normally change this
    value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+/* The `elem' member is an element in the run queue (thread.c).
+   A thread waiting on a semaphore or condition variable is
+   instead in that object's wait queue, through `wait_elem'
+   (synch.c).  The two are separate because a thread in
+   cond_wait() can be preempted, and so be ready to run, before
+   it blocks. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -87,18 +107,53 @@ struct thread
     enum thread_status status;          /* Thread state. */
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
-    int priority;                       /* Priority. */
-    int orig_priority;                     /* Priority when it is running, can be modified by donation. */
+    int priority;                       /* Effective priority. */
+    int base_priority;                  /* Priority without donations. */
     struct list_elem allelem;           /* List element for all threads list. */
     void *aux;
-    struct lock *lock_waiting_for;         /* for nested donation */
-
-    struct list lock_list;
-    int donation_nested_level;
+    unsigned time_slice;                /* Ticks per time slice. */
+    unsigned slice_used;                /* Ticks of slice used before blocking. */
+    bool woken;                         /* Blocked since last run? */
+    unsigned vol_switches;              /* # of times blocked or yielded. */
+    unsigned invol_switches;            /* # of times preempted. */
+    struct cpu *cpu;                    /* CPU running T, or that last did. */
+
+    /* Owned by synch.c. */
+    struct pheap *wait_queue;           /* Wait queue T is in, or null. */
+    struct pheap_elem wait_elem;        /* Element in `wait_queue'. */
+    unsigned wait_seq;                  /* Order of arrival in `wait_queue'. */
+    struct lock *waiting_lock;          /* Lock being waited for, or null. */
+    struct pheap held_locks;            /* Locks held, by donated priority. */
+
+    /* Used by the multi-level feedback queue scheduler. */
+    int nice;                           /* Niceness. */
+    fixed_t recent_cpu;                 /* Recent CPU time received. */
+
+    /* Used by the stride scheduler. */
+    int tickets;                        /* Share of the CPU. */
+    int64_t stride;                     /* Pass increment per tick. */
+    int64_t pass;                       /* Virtual time; least runs first. */
+    struct pheap_elem stride_elem;      /* Element in stride run queue. */
+
+    /* Used by the deadline scheduler.  All times are in timer
+       ticks.  dl_runtime is 0 if T is not a deadline thread. */
+    int64_t dl_runtime;                 /* Runtime budget per period. */
+    int64_t dl_period;                  /* Period. */
+    int64_t dl_deadline;                /* Deadline, relative to period. */
+    int64_t dl_period_start;            /* Start of current period. */
+    int64_t dl_abs_deadline;            /* Current absolute deadline. */
+    int64_t dl_budget;                  /* Runtime left in this period. */
+    struct pheap_elem dl_elem;          /* Element in deadline run queue. */
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
-    int64_t waiting_ticks;
+
+    /* Owned by devices/timer.c. */
+    struct heap_elem sleep_elem;        /* Element in sleeper heap. */
+    struct heap *sleep_heap;            /* Heap T sleeps in, or null. */
+    int64_t wakeup_tick;                /* Tick to wake up at. */
+    uint64_t wakeup_tsc;                /* TSC value to wake up at. */
+    struct pheap_elem throttle_elem;    /* Element in throttled heap. */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
@@ -114,14 +169,38 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If false (default), choose threads by priority.
+   If true, use the stride scheduler, which gives each thread a
+   share of the CPU proportional to its tickets.
+   Controlled by kernel command-line option "-stride". */
+extern bool thread_stride;
+
+/* Maximum number of exited threads' pages kept for reuse.
+   Controlled by kernel command-line option "-thread-cache". */
+extern unsigned thread_cache_limit;
+
+/* Adaptive time slicing.  See thread.c for details. */
+extern unsigned thread_slice_min;
+extern unsigned thread_slice_max;
+extern bool thread_wake_boost;
+
 void thread_init (void);
 void thread_start (void);
+struct thread *thread_create_idle (struct cpu *);
+void thread_start_ap (void) NO_RETURN;
 
 void thread_tick (void);
+void thread_tick_idle (int64_t cnt);
 void thread_print_stats (void);
+size_t thread_cache_reclaim (void);
+unsigned thread_cache_hit_cnt (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
+tid_t thread_create_deadline (const char *name, int64_t runtime,
+                              int64_t period, int64_t deadline,
+                              thread_func *, void *);
+bool thread_deadline_yield (void);
 
 void thread_block (void);
 void thread_unblock (struct thread *);
@@ -132,6 +211,8 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_preempt (void);
+bool thread_preempts (const struct thread *);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
@@ -139,10 +220,14 @@ void thread_foreach (thread_action_func *, void *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_change_priority (struct thread *, int);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
 
+int thread_get_tickets (void);
+void thread_set_tickets (int);
+
 #endif /* threads/thread.h */
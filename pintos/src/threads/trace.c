@@ -0,0 +1,251 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/cpu.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "devices/block.h"
+#include "devices/tsc.h"
+
+/* Scheduler event tracing.
+
+   Events go into a ring buffer of trace_pages pages, allocated
+   only if tracing is enabled, so that a kernel booted without
+   "-trace" pays one predictable branch per trace point and
+   nothing else.  Once the ring is full, new events overwrite
+   the oldest ones.
+
+   Recording an event takes no lock and leaves interrupts alone.
+   A single XADD instruction reserves the next slot, and an
+   interrupt cannot split an instruction, so an interrupt handler
+   that records an event while we are between reserving a slot
+   and filling it in simply gets the slot after ours.  Pintos
+   schedules on one CPU, so there is one ring; with more CPUs
+   each would get a ring of its own, tagged by the "cpu" field.
+
+   At shutdown, trace_dump() writes the trace either to the
+   console, as lines of hex, or raw to the scratch disk.
+   utils/pintos-trace reads either form and converts it to the
+   JSON trace format that chrome://tracing and Perfetto load. */
+
+/* Dump format version, for utils/pintos-trace. */
+#define TRACE_VERSION 1
+
+/* Header at the start of a dump.  Followed by EVENT_CNT struct
+   trace_events, oldest first, and then NAME_CNT struct
+   trace_names. */
+struct trace_header
+  {
+    char magic[4];              /* "PTRC". */
+    uint32_t version;           /* TRACE_VERSION. */
+    uint64_t tsc_hz;            /* TSC frequency, or 0 if unknown. */
+    uint32_t event_cnt;         /* Number of events in dump. */
+    uint32_t name_cnt;          /* Number of thread names in dump. */
+    uint32_t dropped;           /* Number of events overwritten. */
+    uint32_t reserved;          /* Always 0. */
+  };
+
+/* Name of a thread, so that the decoder can label threads that
+   exited before the dump. */
+struct trace_name
+  {
+    int32_t tid;
+    char name[16];
+  };
+
+bool trace_enabled;
+size_t trace_pages;
+bool trace_to_scratch;
+
+/* Ring buffer. */
+static struct trace_event *ring;
+static uint32_t ring_cnt;       /* Number of slots in ring. */
+static uint32_t ring_head;      /* Number of events ever recorded. */
+
+/* Thread names, in order of creation.  Names of threads created
+   after the table fills up are not kept. */
+static struct trace_name *names;
+static uint32_t names_cnt;
+#define NAMES_MAX (PGSIZE / sizeof (struct trace_name))
+
+/* Bytes per line when dumping to the console. */
+#define LINE_BYTES 32
+
+/* Output state for trace_dump(). */
+static struct block *out_block; /* Scratch disk, or NULL for console. */
+static block_sector_t out_sector; /* Next sector to write. */
+static size_t out_size;         /* Bytes per sector or line. */
+static uint8_t out_buf[BLOCK_SECTOR_SIZE];
+static size_t out_ofs;
+
+static void out_bytes (const void *, size_t);
+static void out_flush (void);
+
+/* Initializes tracing, if trace_pages is nonzero.  Must be
+   called after the page allocator is initialized. */
+void
+trace_init (void)
+{
+  if (trace_pages == 0)
+    return;
+  if (!cpu_has (CPUID_TSC))
+    {
+      printf ("trace: no time stamp counter, tracing disabled\n");
+      return;
+    }
+
+  ring = palloc_get_multiple (0, trace_pages);
+  names = palloc_get_page (0);
+  if (ring == NULL || names == NULL)
+    PANIC ("trace: cannot allocate %zu-page ring buffer", trace_pages);
+  /* Round the number of slots down to a power of 2, so that
+     slot numbers stay in order when ring_head wraps around. */
+  ring_cnt = trace_pages * PGSIZE / sizeof *ring;
+  while ((ring_cnt & (ring_cnt - 1)) != 0)
+    ring_cnt &= ring_cnt - 1;
+  ring_head = 0;
+  names_cnt = 0;
+  trace_enabled = true;
+  trace_thread_name (thread_current ()->tid, thread_current ()->name);
+}
+
+/* Records an event of the given TYPE for thread TID with
+   argument ARG.  Called through trace_event(). */
+void
+trace_record (enum trace_type type, int tid, int arg)
+{
+  uint32_t slot = 1;
+  struct trace_event *e;
+
+  asm volatile ("xaddl %0, %1" : "+r" (slot), "+m" (ring_head) : : "memory");
+  e = &ring[slot & (ring_cnt - 1)];
+  e->tsc = rdtsc ();
+  e->type = type;
+  e->cpu = 0;
+  e->arg = arg;
+  e->tid = tid;
+}
+
+/* Records that thread TID is called NAME. */
+void
+trace_thread_name (int tid, const char *name)
+{
+  uint32_t slot;
+
+  if (!trace_enabled || names_cnt >= NAMES_MAX)
+    return;
+
+  slot = 1;
+  asm volatile ("xaddl %0, %1" : "+r" (slot), "+m" (names_cnt) : : "memory");
+  if (slot < NAMES_MAX)
+    {
+      names[slot].tid = tid;
+      strlcpy (names[slot].name, name, sizeof names[slot].name);
+    }
+}
+
+/* Stops tracing and writes out the trace: to the scratch disk,
+   if trace_to_scratch is true and there is a scratch disk big
+   enough to hold it, otherwise to the console, between lines
+   "Trace: begin" and "Trace: end". */
+void
+trace_dump (void)
+{
+  struct trace_header h;
+  uint32_t head, event_cnt, name_cnt, i;
+  size_t size;
+
+  if (ring == NULL)
+    return;
+  trace_enabled = false;
+
+  head = ring_head;
+  event_cnt = head < ring_cnt ? head : ring_cnt;
+  name_cnt = names_cnt < NAMES_MAX ? names_cnt : NAMES_MAX;
+  size = (sizeof h + event_cnt * sizeof *ring
+          + name_cnt * sizeof *names);
+
+  out_block = NULL;
+  if (trace_to_scratch) 
+    {
+      out_block = block_get_role (BLOCK_SCRATCH);
+      if (out_block == NULL
+          || block_size (out_block) * BLOCK_SECTOR_SIZE < size) 
+        {
+          printf ("trace: scratch disk missing or too small, "
+                  "dumping to console\n");
+          out_block = NULL;
+        }
+    }
+  out_sector = 0;
+  out_size = out_block != NULL ? BLOCK_SECTOR_SIZE : LINE_BYTES;
+  out_ofs = 0;
+
+  memset (&h, 0, sizeof h);
+  memcpy (h.magic, "PTRC", sizeof h.magic);
+  h.version = TRACE_VERSION;
+  h.tsc_hz = tsc_hz ();
+  h.event_cnt = event_cnt;
+  h.name_cnt = name_cnt;
+  h.dropped = head - event_cnt;
+
+  if (out_block == NULL)
+    printf ("Trace: begin\n");
+  out_bytes (&h, sizeof h);
+  for (i = head - event_cnt; i != head; i++)
+    out_bytes (&ring[i & (ring_cnt - 1)], sizeof *ring);
+  out_bytes (names, name_cnt * sizeof *names);
+  out_flush ();
+  if (out_block == NULL)
+    printf ("Trace: end\n");
+  else
+    printf ("trace: wrote %"PRIu32" events to %s\n",
+            event_cnt, block_name (out_block));
+}
+
+/* Appends the SIZE bytes at BUFFER to the dump. */
+static void
+out_bytes (const void *buffer_, size_t size) 
+{
+  const uint8_t *buffer = buffer_;
+
+  while (size > 0) 
+    {
+      size_t chunk = out_size - out_ofs;
+      if (chunk > size)
+        chunk = size;
+      memcpy (out_buf + out_ofs, buffer, chunk);
+      out_ofs += chunk;
+      buffer += chunk;
+      size -= chunk;
+      if (out_ofs == out_size)
+        out_flush ();
+    }
+}
+
+/* Writes out the partial sector or line in out_buf, if any. */
+static void
+out_flush (void) 
+{
+  size_t i;
+
+  if (out_ofs == 0)
+    return;
+
+  if (out_block != NULL) 
+    {
+      memset (out_buf + out_ofs, 0, BLOCK_SECTOR_SIZE - out_ofs);
+      block_write (out_block, out_sector++, out_buf);
+    }
+  else 
+    {
+      printf ("Trace: ");
+      for (i = 0; i < out_ofs; i++)
+        printf ("%02x", out_buf[i]);
+      printf ("\n");
+    }
+  out_ofs = 0;
+}
@@ -0,0 +1,63 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Scheduler trace event types.  The numbers are part of the
+   dump format read by utils/pintos-trace, so only add to the
+   end. */
+enum trace_type
+  {
+    TRACE_SWITCH = 1,           /* TID starts running at priority ARG. */
+    TRACE_WAKEUP = 2,           /* TID becomes ready at priority ARG. */
+    TRACE_BLOCK = 3,            /* TID blocks. */
+    TRACE_DONATE = 4,           /* TID's priority is raised to ARG. */
+    TRACE_INTR_ENTER = 5,       /* External interrupt ARG starts. */
+    TRACE_INTR_EXIT = 6         /* External interrupt ARG ends. */
+  };
+
+/* One trace event, as stored in the ring buffer and dumped. */
+struct trace_event
+  {
+    uint64_t tsc;               /* Time stamp counter value. */
+    uint8_t type;               /* One of enum trace_type. */
+    uint8_t cpu;                /* CPU the event happened on. */
+    uint16_t arg;               /* Priority or interrupt vector. */
+    int32_t tid;                /* Thread the event concerns. */
+  };
+
+/* If false (default), trace_event() does nothing.
+   Set by trace_init() if kernel command-line option "-trace"
+   was given. */
+extern bool trace_enabled;
+
+/* Ring buffer size, in pages, or 0 to disable tracing.
+   Set by kernel command-line option "-trace". */
+extern size_t trace_pages;
+
+/* Ring buffer size for "-trace" without a size. */
+#define TRACE_DEFAULT_PAGES 32
+
+/* If true, trace_dump() writes the trace to the scratch disk
+   instead of the console.  Set by kernel command-line option
+   "-trace-scratch". */
+extern bool trace_to_scratch;
+
+void trace_init (void);
+void trace_record (enum trace_type, int tid, int arg);
+void trace_thread_name (int tid, const char *name);
+void trace_dump (void);
+
+/* Records an event of the given TYPE for thread TID with
+   argument ARG, if tracing is enabled.  Costs one load and one
+   branch when it is not. */
+static inline void
+trace_event (enum trace_type type, int tid, int arg)
+{
+  if (trace_enabled)
+    trace_record (type, tid, arg);
+}
+
+#endif /* threads/trace.h */
@@ -0,0 +1,91 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* A work queue: a list of work items and a kernel thread that
+   runs them in order. */
+struct workqueue
+  {
+    struct list items;          /* Pending work items. */
+    struct semaphore ready;     /* Number of pending work items. */
+  };
+
+static thread_func worker;
+
+/* Initializes W to run FUNC when it is queued. */
+void
+work_init (struct work *w, work_func *func) 
+{
+  ASSERT (w != NULL);
+  ASSERT (func != NULL);
+
+  w->func = func;
+  w->pending = false;
+}
+
+/* Creates a work queue whose items run in a new kernel thread
+   with the given NAME and PRIORITY.  Returns the new work queue,
+   or a null pointer if memory or a thread is not available. */
+struct workqueue *
+workqueue_create (const char *name, int priority) 
+{
+  struct workqueue *wq = malloc (sizeof *wq);
+  if (wq == NULL)
+    return NULL;
+
+  list_init (&wq->items);
+  sema_init (&wq->ready, 0);
+  if (thread_create (name, priority, worker, wq) == TID_ERROR) 
+    {
+      free (wq);
+      return NULL;
+    }
+  return wq;
+}
+
+/* Queues W to run in WQ's thread.  Returns true if W was queued,
+   false if it was already pending.  May be called from an
+   interrupt handler. */
+bool
+workqueue_queue (struct workqueue *wq, struct work *w) 
+{
+  enum intr_level old_level;
+  bool queued = false;
+
+  old_level = intr_disable ();
+  if (!w->pending) 
+    {
+      w->pending = true;
+      list_push_back (&wq->items, &w->elem);
+      sema_up (&wq->ready);
+      queued = true;
+    }
+  intr_set_level (old_level);
+
+  return queued;
+}
+
+/* Thread function for a work queue's thread.  Runs work items
+   as they are queued, forever. */
+static void
+worker (void *wq_) 
+{
+  struct workqueue *wq = wq_;
+
+  for (;;) 
+    {
+      enum intr_level old_level;
+      struct work *w;
+
+      sema_down (&wq->ready);
+      old_level = intr_disable ();
+      w = list_entry (list_pop_front (&wq->items), struct work, elem);
+      w->pending = false;
+      intr_set_level (old_level);
+
+      w->func (w);
+    }
+}
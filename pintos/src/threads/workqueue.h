@@ -0,0 +1,55 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Deferred work.
+
+   An interrupt handler that has more to do than acknowledge its
+   device can package the rest as a work item and queue it in
+   one of two places:
+
+     - intr_defer() (see interrupt.h) runs it as a "softirq",
+       just before the interrupt returns, after the interrupt
+       controller has been acknowledged and with interrupts
+       turned back on.  Like the handler itself, it runs on the
+       interrupted thread's stack and may not sleep.  It may
+       call intr_yield_on_return().
+
+     - workqueue_queue() runs it in a kernel thread belonging to
+       the work queue, at the work queue's priority.  It may
+       sleep.
+
+   Either way, a work item is queued at most once: queuing an
+   item that is already pending has no effect, so a handler that
+   fires again before its work has run does not need to count. */
+
+struct work;
+typedef void work_func (struct work *);
+
+/* A work item.  Usually static, or embedded in the structure
+   that the work is about. */
+struct work
+  {
+    struct list_elem elem;      /* Element in a queue. */
+    work_func *func;            /* Function to run. */
+    bool pending;               /* Queued but not yet started? */
+  };
+
+/* Converts pointer to work item WORK into a pointer to the
+   structure that WORK is embedded inside.  Supply the name of
+   the outer structure STRUCT and the member name MEMBER of the
+   work item. */
+#define work_entry(WORK, STRUCT, MEMBER)                        \
+        ((STRUCT *) ((uint8_t *) (WORK) - offsetof (STRUCT, MEMBER)))
+
+void work_init (struct work *, work_func *);
+
+struct workqueue;
+struct workqueue *workqueue_create (const char *name, int priority);
+bool workqueue_queue (struct workqueue *, struct work *);
+
+#endif /* threads/workqueue.h */
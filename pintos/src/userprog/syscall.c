@@ -3,8 +3,11 @@
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
 
 static void syscall_handler (struct intr_frame *);
+static bool get_user_arg (const struct intr_frame *, int idx, int *value);
 
 void
 syscall_init (void) 
@@ -13,8 +16,41 @@ syscall_init (void)
 }
 
 static void
-syscall_handler (struct intr_frame *f UNUSED) 
+syscall_handler (struct intr_frame *f) 
 {
+  int number, arg;
+
+  if (get_user_arg (f, 0, &number) && number == SYS_SET_TICKETS
+      && get_user_arg (f, 1, &arg))
+    {
+      if (TICKETS_MIN <= arg && arg <= TICKETS_MAX)
+        {
+          thread_set_tickets (arg);
+          f->eax = true;
+        }
+      else
+        f->eax = false;
+      return;
+    }
+
   printf ("system call!\n");
   thread_exit ();
 }
+
+/* Reads the IDX'th 32-bit word on F's user stack, where word 0
+   is the system call number, into *VALUE.  Returns false if the
+   word is not in mapped user memory. */
+static bool
+get_user_arg (const struct intr_frame *f, int idx, int *value)
+{
+  const int *p = (const int *) f->esp + idx;
+  const int *kp;
+
+  if (!is_user_vaddr (p + 1) || pg_ofs (p) > PGSIZE - sizeof *p)
+    return false;
+  kp = pagedir_get_page (thread_current ()->pagedir, p);
+  if (kp == NULL)
+    return false;
+  *value = *kp;
+  return true;
+}
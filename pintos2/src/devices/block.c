@@ -28,6 +28,7 @@ static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
 static struct block *list_elem_to_block (struct list_elem *);
+static void check_sectors (struct block *, block_sector_t, size_t cnt);
 
 /* Returns a human-readable name for the given block device
    TYPE. */
@@ -104,12 +105,21 @@ block_get_by_name (const char *name)
 static void
 check_sector (struct block *block, block_sector_t sector)
 {
-  if (sector >= block->size)
+  check_sectors (block, sector, 1);
+}
+
+/* Verifies that the CNT sectors starting at SECTOR all lie
+   within BLOCK.  Panics if not. */
+static void
+check_sectors (struct block *block, block_sector_t sector, size_t cnt)
+{
+  if (sector >= block->size || cnt > block->size - sector)
     {
       /* We do not use ASSERT because we want to panic here
          regardless of whether NDEBUG is defined. */
-      PANIC ("Access past end of device %s (sector=%"PRDSNu", "
-             "size=%"PRDSNu")\n", block_name (block), sector, block->size);
+      PANIC ("Access past end of device %s (sector=%"PRDSNu", cnt=%zu, "
+             "size=%"PRDSNu")\n", block_name (block), sector, cnt,
+             block->size);
     }
 }
 
@@ -139,6 +149,52 @@ block_write (struct block *block, block_sector_t sector, const void *buffer)
   block->write_cnt++;
 }
 
+/* Reads the CNT sectors starting at SECTOR from BLOCK into
+   BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes.  Uses a single device command if the driver supports
+   it.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_read_multiple (struct block *block, block_sector_t sector, size_t cnt,
+                     void *buffer)
+{
+  uint8_t *p = buffer;
+  size_t i;
+
+  check_sectors (block, sector, cnt);
+  if (block->ops->read_multiple != NULL)
+    block->ops->read_multiple (block->aux, sector, cnt, buffer);
+  else
+    for (i = 0; i < cnt; i++)
+      block->ops->read (block->aux, sector + i, p + i * BLOCK_SECTOR_SIZE);
+  block->read_cnt += cnt;
+}
+
+/* Writes the CNT sectors starting at SECTOR on BLOCK from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.
+   Uses a single device command if the driver supports it.
+   Returns after the block device has acknowledged receiving the
+   data.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_write_multiple (struct block *block, block_sector_t sector, size_t cnt,
+                      const void *buffer)
+{
+  const uint8_t *p = buffer;
+  size_t i;
+
+  check_sectors (block, sector, cnt);
+  ASSERT (block->type != BLOCK_FOREIGN);
+  if (block->ops->write_multiple != NULL)
+    block->ops->write_multiple (block->aux, sector, cnt, buffer);
+  else
+    for (i = 0; i < cnt; i++)
+      block->ops->write (block->aux, sector + i, p + i * BLOCK_SECTOR_SIZE);
+  block->write_cnt += cnt;
+}
+
 /* Returns the number of sectors in BLOCK. */
 block_sector_t
 block_size (struct block *block)
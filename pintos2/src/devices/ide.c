@@ -47,8 +47,8 @@
    Many more are defined but this is the small subset that we
    use. */
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
-#define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
-#define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR(S) with retries. */
+#define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR(S) with retries. */
 
 /* An ATA device. */
 struct ata_disk
@@ -85,7 +85,7 @@ static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
 
-static void select_sector (struct ata_disk *, block_sector_t);
+static void select_sectors (struct ata_disk *, block_sector_t, size_t sec_cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
@@ -337,63 +337,131 @@ descramble_ata_string (char *string, int size)
   return string;
 }
 
-/* Reads sector SEC_NO from disk D into BUFFER, which must have
-   room for BLOCK_SECTOR_SIZE bytes.
+/* Maximum number of sectors in one READ or WRITE SECTORS
+   command. */
+#define MAX_SECTORS_PER_CMD 256
+
+/* Reads the CNT sectors starting at SEC_NO from disk D into
+   BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes, issuing one command per MAX_SECTORS_PER_CMD sectors.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_read (void *d_, block_sector_t sec_no, void *buffer)
+ide_read_multiple (void *d_, block_sector_t sec_no, size_t cnt, void *buffer)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
+  uint8_t *p = buffer;
+
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
+  while (cnt > 0)
+    {
+      size_t sec_cnt = cnt < MAX_SECTORS_PER_CMD ? cnt : MAX_SECTORS_PER_CMD;
+      size_t i;
+
+      select_sectors (d, sec_no, sec_cnt);
+      issue_pio_command (c, CMD_READ_SECTOR_RETRY);
+
+      /* The disk interrupts once for each sector that it has
+         ready for us. */
+      for (i = 0; i < sec_cnt; i++)
+        {
+          sema_down (&c->completion_wait);
+          if (!wait_while_busy (d))
+            PANIC ("%s: disk read failed, sector=%"PRDSNu,
+                   d->name, sec_no + i);
+          input_sector (c, p);
+          p += BLOCK_SECTOR_SIZE;
+        }
+      sec_no += sec_cnt;
+      cnt -= sec_cnt;
+    }
   lock_release (&c->lock);
 }
 
-/* Write sector SEC_NO to disk D from BUFFER, which must contain
-   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
-   acknowledged receiving the data.
+/* Writes the CNT sectors starting at SEC_NO to disk D from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes,
+   issuing one command per MAX_SECTORS_PER_CMD sectors.  Returns
+   after the disk has acknowledged receiving the data.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_write (void *d_, block_sector_t sec_no, const void *buffer)
+ide_write_multiple (void *d_, block_sector_t sec_no, size_t cnt,
+                    const void *buffer)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
+  const uint8_t *p = buffer;
+
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
+  while (cnt > 0)
+    {
+      size_t sec_cnt = cnt < MAX_SECTORS_PER_CMD ? cnt : MAX_SECTORS_PER_CMD;
+      size_t i;
+
+      select_sectors (d, sec_no, sec_cnt);
+      issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
+
+      /* The disk interrupts after taking each sector, when it is
+         ready for the next one or, after the last, done. */
+      for (i = 0; i < sec_cnt; i++)
+        {
+          if (!wait_while_busy (d))
+            PANIC ("%s: disk write failed, sector=%"PRDSNu,
+                   d->name, sec_no + i);
+          output_sector (c, p);
+          p += BLOCK_SECTOR_SIZE;
+          sema_down (&c->completion_wait);
+        }
+      sec_no += sec_cnt;
+      cnt -= sec_cnt;
+    }
   lock_release (&c->lock);
 }
 
+/* Reads sector SEC_NO from disk D into BUFFER, which must have
+   room for BLOCK_SECTOR_SIZE bytes.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_read (void *d_, block_sector_t sec_no, void *buffer)
+{
+  ide_read_multiple (d_, sec_no, 1, buffer);
+}
+
+/* Write sector SEC_NO to disk D from BUFFER, which must contain
+   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
+   acknowledged receiving the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_write (void *d_, block_sector_t sec_no, const void *buffer)
+{
+  ide_write_multiple (d_, sec_no, 1, buffer);
+}
+
 static struct block_operations ide_operations =
   {
     ide_read,
-    ide_write
+    ide_write,
+    ide_read_multiple,
+    ide_write_multiple
   };
-
+
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and SEC_CNT, which must be between 1 and
+   MAX_SECTORS_PER_CMD, to the disk's sector selection registers.
+   (We use LBA mode.) */
 static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+select_sectors (struct ata_disk *d, block_sector_t sec_no, size_t sec_cnt)
 {
   struct channel *c = d->channel;
 
   ASSERT (sec_no < (1UL << 28));
+  ASSERT (sec_cnt >= 1 && sec_cnt <= MAX_SECTORS_PER_CMD);
   
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), sec_cnt == MAX_SECTORS_PER_CMD ? 0 : sec_cnt);
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -5,6 +5,7 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
@@ -127,6 +128,9 @@ print_stats (void)
 #endif
   console_print_stats ();
   kbd_print_stats ();
+#ifdef LOCKSTAT
+  lockstat_print_stats ();
+#endif
 #ifdef USERPROG
   exception_print_stats ();
 #endif
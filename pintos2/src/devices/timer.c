@@ -168,10 +168,10 @@ timer_print_stats (void)
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+timer_interrupt (struct intr_frame *args)
 {
   ticks++;
-  thread_tick ();
+  thread_tick (args);
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
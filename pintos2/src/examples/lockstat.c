@@ -0,0 +1,41 @@
+/* lockstat.c
+
+   Prints the kernel's lock contention statistics, most contended
+   lock first.  The kernel must have been built with
+   "make LOCKSTAT=1". */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <syscall.h>
+
+/* Most lock classes to report. */
+#define STATS_MAX 32
+
+static struct lockstat stats[STATS_MAX];
+
+int
+main (void) 
+{
+  int cnt, i;
+
+  cnt = lockstat (stats, STATS_MAX);
+  if (cnt < 0) 
+    {
+      printf ("lockstat: kernel built without LOCKSTAT\n");
+      return EXIT_FAILURE;
+    }
+
+  printf ("%10s %10s %14s %12s %14s %12s  %s\n",
+          "acquired", "contended", "wait cycles", "max wait",
+          "hold cycles", "max hold", "lock");
+  for (i = 0; i < cnt; i++) 
+    {
+      const struct lockstat *s = &stats[i];
+      printf ("%10"PRIu32" %10"PRIu32" %14"PRIu64" %12"PRIu64
+              " %14"PRIu64" %12"PRIu64"  %s\n",
+              s->acquired, s->contended, s->wait_cycles,
+              s->max_wait_cycles, s->hold_cycles, s->max_hold_cycles,
+              s->name);
+    }
+  return EXIT_SUCCESS;
+}
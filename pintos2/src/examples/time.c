@@ -0,0 +1,58 @@
+/* time.c
+
+   Runs the command given on the command line, waits for it to
+   exit, and reports the resources that it and the children it
+   waited for used. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+
+int
+main (int argc, char *argv[]) 
+{
+  char command[128];
+  struct rusage usage;
+  pid_t pid;
+  int status;
+  int i;
+
+  if (argc < 2) 
+    {
+      printf ("usage: time COMMAND [ARG...]\n");
+      return EXIT_FAILURE;
+    }
+
+  command[0] = '\0';
+  for (i = 1; i < argc; i++) 
+    {
+      if (i > 1)
+        strlcat (command, " ", sizeof command);
+      strlcat (command, argv[i], sizeof command);
+    }
+
+  pid = exec (command);
+  if (pid == PID_ERROR) 
+    {
+      printf ("time: %s: exec failed\n", argv[1]);
+      return EXIT_FAILURE;
+    }
+  status = wait (pid);
+
+  if (getrusage (RUSAGE_CHILDREN, &usage) < 0) 
+    {
+      printf ("time: getrusage failed\n");
+      return EXIT_FAILURE;
+    }
+  printf ("%s: exit status %d\n", argv[1], status);
+  printf ("%"PRId64" user ticks, %"PRId64" kernel ticks\n",
+          usage.user_ticks, usage.kernel_ticks);
+  printf ("%"PRIu32" voluntary, %"PRIu32" involuntary context switches\n",
+          usage.vol_switches, usage.invol_switches);
+  printf ("%"PRIu32" page faults, %"PRIu32" swap-ins\n",
+          usage.page_faults, usage.swap_ins);
+  printf ("%"PRId64" bytes read, %"PRId64" bytes written\n",
+          usage.bytes_read, usage.bytes_written);
+  return status;
+}
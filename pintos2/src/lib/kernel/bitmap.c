@@ -296,16 +296,45 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt)
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
+  elem_type none = value ? 0 : (elem_type) -1;  /* No bit is VALUE. */
+  size_t run_start = start;
+  size_t i;
+
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
-  if (cnt <= b->bit_cnt) 
+  if (cnt == 0)
+    return start;
+
+  /* Track the run of VALUE bits that ends at I, looking at whole
+     elements at a time where possible so that long stretches of
+     the wrong value, or of the right one, are skipped quickly. */
+  i = start;
+  while (i < b->bit_cnt)
     {
-      size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
+      if (i % ELEM_BITS == 0 && i + ELEM_BITS <= b->bit_cnt)
+        {
+          elem_type e = b->bits[elem_idx (i)];
+          if (e == none)
+            {
+              i += ELEM_BITS;
+              run_start = i;
+              continue;
+            }
+          else if (e == ~none)
+            {
+              i += ELEM_BITS;
+              if (i - run_start >= cnt)
+                return run_start;
+              continue;
+            }
+        }
+
+      if (bitmap_test (b, i) != value)
+        run_start = i + 1;
+      i++;
+      if (i - run_start >= cnt)
+        return run_start;
     }
   return BITMAP_ERROR;
 }
@@ -0,0 +1,21 @@
+#ifndef __LIB_LOCKSTAT_H
+#define __LIB_LOCKSTAT_H
+
+#include <stdint.h>
+
+/* Contention statistics for one class of locks, that is, all the
+   locks initialized at one place in the kernel, as returned by
+   the lockstat() system call.  Shared between the kernel and
+   user programs.  Times are in CPU cycles. */
+struct lockstat
+  {
+    char name[48];              /* Lock and where it was initialized. */
+    uint32_t acquired;          /* # of times acquired. */
+    uint32_t contended;         /* # of times a thread had to wait. */
+    uint64_t wait_cycles;       /* Total time spent waiting. */
+    uint64_t max_wait_cycles;   /* Longest wait. */
+    uint64_t hold_cycles;       /* Total time held. */
+    uint64_t max_hold_cycles;   /* Longest hold. */
+  };
+
+#endif /* lib/lockstat.h */
@@ -0,0 +1,24 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+#include <stdint.h>
+
+/* Resource usage of a process, as returned by the getrusage()
+   system call.  Shared between the kernel and user programs. */
+struct rusage
+  {
+    int64_t user_ticks;         /* Timer ticks spent in user mode. */
+    int64_t kernel_ticks;       /* Timer ticks spent in the kernel. */
+    uint32_t vol_switches;      /* # of times blocked or yielded. */
+    uint32_t invol_switches;    /* # of times preempted. */
+    uint32_t page_faults;       /* # of page faults. */
+    uint32_t swap_ins;          /* # of pages read back from swap. */
+    int64_t bytes_read;         /* Bytes read by read(). */
+    int64_t bytes_written;      /* Bytes written by write(). */
+  };
+
+/* Values for getrusage()'s WHO argument. */
+#define RUSAGE_SELF 0           /* The calling process. */
+#define RUSAGE_CHILDREN 1       /* Its children that have been waited for. */
+
+#endif /* lib/rusage.h */
@@ -182,3 +182,15 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+int
+getrusage (int who, struct rusage *usage) 
+{
+  return syscall2 (SYS_GETRUSAGE, who, usage);
+}
+
+int
+lockstat (struct lockstat *stats, int cnt) 
+{
+  return syscall2 (SYS_LOCKSTAT, stats, cnt);
+}
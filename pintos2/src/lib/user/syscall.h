@@ -3,6 +3,8 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <lockstat.h>
+#include <rusage.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +47,8 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Accounting. */
+int getrusage (int who, struct rusage *usage);
+int lockstat (struct lockstat *stats, int cnt);
+
 #endif /* lib/user/syscall.h */
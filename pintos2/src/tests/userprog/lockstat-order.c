@@ -0,0 +1,49 @@
+/* Checks that lockstat() rejects a negative count and, if the
+   kernel keeps lock statistics, that it reports the lock that
+   serializes system calls, most contended lock first, with
+   self-consistent numbers. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Most lock classes to fetch. */
+#define STATS_MAX 32
+
+static struct lockstat stats[STATS_MAX];
+
+void
+test_main (void) 
+{
+  bool found = false;
+  int cnt, i;
+
+  CHECK (lockstat (stats, -1) == -1, "lockstat (-1) must fail");
+
+  cnt = lockstat (stats, STATS_MAX);
+  if (cnt < 0) 
+    {
+      msg ("kernel built without LOCKSTAT");
+      return;
+    }
+
+  for (i = 0; i < cnt; i++) 
+    {
+      const struct lockstat *s = &stats[i];
+      if (s->acquired == 0)
+        fail ("%s: reported but never acquired", s->name);
+      if (s->contended > s->acquired)
+        fail ("%s: contended more often than acquired", s->name);
+      if (s->max_wait_cycles > s->wait_cycles
+          || s->max_hold_cycles > s->hold_cycles)
+        fail ("%s: maximum exceeds total", s->name);
+      if (i > 0 && s->wait_cycles > stats[i - 1].wait_cycles)
+        fail ("%s: not sorted by wait time", s->name);
+      if (!memcmp (s->name, "syscall_lock ", strlen ("syscall_lock ")))
+        found = true;
+    }
+  if (cnt < STATS_MAX && !found)
+    fail ("syscall_lock not reported");
+  msg ("lock statistics are consistent");
+}
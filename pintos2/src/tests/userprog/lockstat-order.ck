@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF', <<'EOF']);
+(lockstat-order) begin
+(lockstat-order) lockstat (-1) must fail
+(lockstat-order) lock statistics are consistent
+(lockstat-order) end
+lockstat-order: exit(0)
+EOF
+(lockstat-order) begin
+(lockstat-order) lockstat (-1) must fail
+(lockstat-order) kernel built without LOCKSTAT
+(lockstat-order) end
+lockstat-order: exit(0)
+EOF
+pass;
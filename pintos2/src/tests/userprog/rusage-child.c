@@ -0,0 +1,28 @@
+/* Checks that a child's resource usage is added to its parent's
+   RUSAGE_CHILDREN totals when the parent waits for it, and that
+   getrusage() rejects an invalid WHO. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct rusage usage;
+
+  CHECK (getrusage (RUSAGE_CHILDREN, &usage) == 0, "getrusage (children)");
+  if (usage.bytes_written != 0 || usage.user_ticks != 0)
+    fail ("children's usage is not zero before any wait");
+
+  msg ("wait(exec()) = %d", wait (exec ("child-simple")));
+
+  CHECK (getrusage (RUSAGE_CHILDREN, &usage) == 0, "getrusage (children)");
+  msg ("child wrote %d bytes", (int) usage.bytes_written);
+
+  CHECK (getrusage (RUSAGE_SELF, &usage) == 0, "getrusage (self)");
+  if (usage.bytes_written == 0)
+    fail ("own writes not counted");
+
+  CHECK (getrusage (2, &usage) == -1, "getrusage (2) must fail");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my ($name) = $test =~ m%([^/]+)$%;
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+@output = get_core_output ("run", @output);
+fail "missing fault rate in output"
+  unless grep (/^\($name\) \d+ faults in \d+ page touches, \d+ per 1000$/,
+	       @output);
+fail "missing end in output"
+  unless grep ($_ eq "($name) end", @output);
+
+pass;
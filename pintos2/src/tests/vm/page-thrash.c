@@ -0,0 +1,64 @@
+/* Thrash benchmark for page replacement.
+
+   Keeps touching a small "hot" set of pages while sweeping
+   through a "cold" region four times its size, and reports how
+   many page faults that took.  This is a loop of its own, not
+   page-parallel or page-merge-*.  Run with a -ul limit that
+   holds the hot set but not the cold region, a policy that keeps
+   recently used pages in memory (such as the clock) faults
+   mostly on cold pages, whereas FIFO keeps evicting hot pages as
+   well.  page-thrash-64, page-thrash-128, and page-thrash-256
+   run it under different -ul limits.
+
+   Their .ck files only check that the fault count is reported,
+   not what it is, since that depends on the replacement policy
+   and the -ul limit; compare the counts by hand.  The test does
+   fail if a page does not still hold what was last written to
+   it. */
+
+#include <inttypes.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define HOT_PAGES 32            /* 128 kB touched every round. */
+#define COLD_PAGES 128          /* 512 kB swept once every 4 rounds. */
+#define ROUNDS 32
+#define HOT_TOUCHES 4           /* Times each hot page is touched per round. */
+
+static char hot[HOT_PAGES][PAGE_SIZE];
+static char cold[COLD_PAGES][PAGE_SIZE];
+
+void
+test_main (void) 
+{
+  struct rusage before, after;
+  uint32_t faults;
+  int touches = 0;
+  int round, i, j;
+
+  CHECK (getrusage (RUSAGE_SELF, &before) == 0, "getrusage");
+  for (round = 0; round < ROUNDS; round++) 
+    {
+      int cold_start = round % 4 * (COLD_PAGES / 4);
+
+      for (j = 0; j < HOT_TOUCHES; j++)
+        for (i = 0; i < HOT_PAGES; i++, touches++)
+          hot[i][0] = round;
+      for (i = cold_start; i < cold_start + COLD_PAGES / 4; i++, touches++)
+        cold[i][0] = round;
+    }
+  getrusage (RUSAGE_SELF, &after);
+
+  for (i = 0; i < HOT_PAGES; i++)
+    if (hot[i][0] != ROUNDS - 1)
+      fail ("hot page %d holds %d, not %d", i, hot[i][0], ROUNDS - 1);
+  for (i = 0; i < COLD_PAGES; i++)
+    if (cold[i][0] != ROUNDS - 4 + i / (COLD_PAGES / 4))
+      fail ("cold page %d holds %d", i, cold[i][0]);
+
+  faults = after.page_faults - before.page_faults;
+  msg ("%"PRIu32" faults in %d page touches, %"PRIu32" per 1000",
+       faults, touches, faults * 1000 / touches);
+}
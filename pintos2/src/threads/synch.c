@@ -27,11 +27,32 @@
 */
 
 #include "threads/synch.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/thread.h"
 
+#ifdef LOCKSTAT
+/* All lock classes that have been used to initialize a lock. */
+static struct list lock_classes = LIST_INITIALIZER (lock_classes);
+
+static void lockstat_acquired (struct lock *, bool contended,
+                               uint64_t wait_cycles);
+static void lockstat_released (struct lock *);
+
+/* Returns the value of the CPU's time stamp counter.
+   See [IA32-v2b] "RDTSC". */
+static inline uint64_t
+rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+#endif
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -171,14 +192,32 @@ sema_test_helper (void *sema_)
    another one "up" it, but with a lock the same thread must both
    acquire and release it.  When these restrictions prove
    onerous, it's a good sign that a semaphore should be used,
-   instead of a lock. */
+   instead of a lock.
+
+   With LOCKSTAT, lock_init() is a macro that passes the lock
+   class for its call site to this function as CLASS. */
+#ifdef LOCKSTAT
+void
+lock_init_class (struct lock *lock, struct lock_class *class)
+#else
 void
 lock_init (struct lock *lock)
+#endif
 {
   ASSERT (lock != NULL);
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+
+#ifdef LOCKSTAT
+  {
+    enum intr_level old_level = intr_disable ();
+    if (class->elem.next == NULL)
+      list_push_back (&lock_classes, &class->elem);
+    intr_set_level (old_level);
+    lock->class = class;
+  }
+#endif
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -196,7 +235,18 @@ lock_acquire (struct lock *lock)
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+#ifdef LOCKSTAT
+  if (sema_try_down (&lock->semaphore))
+    lockstat_acquired (lock, false, 0);
+  else 
+    {
+      uint64_t start = rdtsc ();
+      sema_down (&lock->semaphore);
+      lockstat_acquired (lock, true, rdtsc () - start);
+    }
+#else
   sema_down (&lock->semaphore);
+#endif
   lock->holder = thread_current ();
 }
 
@@ -215,8 +265,13 @@ lock_try_acquire (struct lock *lock)
   ASSERT (!lock_held_by_current_thread (lock));
 
   success = sema_try_down (&lock->semaphore);
-  if (success)
-    lock->holder = thread_current ();
+  if (success) 
+    {
+#ifdef LOCKSTAT
+      lockstat_acquired (lock, false, 0);
+#endif
+      lock->holder = thread_current ();
+    }
   return success;
 }
 
@@ -231,6 +286,9 @@ lock_release (struct lock *lock)
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+#ifdef LOCKSTAT
+  lockstat_released (lock);
+#endif
   lock->holder = NULL;
   sema_up (&lock->semaphore);
 }
@@ -336,3 +394,118 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+#ifdef LOCKSTAT
+/* Accounts for LOCK having just been acquired, after waiting
+   WAIT_CYCLES for it if CONTENDED. */
+static void
+lockstat_acquired (struct lock *lock, bool contended, uint64_t wait_cycles) 
+{
+  struct lockstat *s = &lock->class->stats;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  s->acquired++;
+  if (contended) 
+    {
+      s->contended++;
+      s->wait_cycles += wait_cycles;
+      if (wait_cycles > s->max_wait_cycles)
+        s->max_wait_cycles = wait_cycles;
+    }
+  intr_set_level (old_level);
+
+  lock->acquire_time = rdtsc ();
+}
+
+/* Accounts for LOCK being about to be released. */
+static void
+lockstat_released (struct lock *lock) 
+{
+  struct lockstat *s = &lock->class->stats;
+  uint64_t hold_cycles = rdtsc () - lock->acquire_time;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  s->hold_cycles += hold_cycles;
+  if (hold_cycles > s->max_hold_cycles)
+    s->max_hold_cycles = hold_cycles;
+  intr_set_level (old_level);
+}
+
+/* Orders lock classes by total time spent waiting for them,
+   longest first, then by number of acquisitions. */
+static bool
+more_contended (const struct list_elem *a_, const struct list_elem *b_,
+                void *aux UNUSED) 
+{
+  const struct lockstat *a = &list_entry (a_, struct lock_class, elem)->stats;
+  const struct lockstat *b = &list_entry (b_, struct lock_class, elem)->stats;
+
+  if (a->wait_cycles != b->wait_cycles)
+    return a->wait_cycles > b->wait_cycles;
+  return a->acquired > b->acquired;
+}
+
+/* Copies the statistics of up to CNT lock classes that have
+   been acquired at least once into STATS, most contended first.
+   Returns the number of classes copied. */
+int
+lockstat_get (struct lockstat *stats, int cnt) 
+{
+  enum intr_level old_level;
+  struct list_elem *e;
+  int i = 0;
+
+  old_level = intr_disable ();
+  list_sort (&lock_classes, more_contended, NULL);
+  for (e = list_begin (&lock_classes);
+       e != list_end (&lock_classes) && i < cnt; e = list_next (e)) 
+    {
+      struct lock_class *c = list_entry (e, struct lock_class, elem);
+      const char *name = c->name + (c->name[0] == '&');
+      const char *file = c->file;
+
+      if (c->stats.acquired == 0)
+        continue;
+      while (!memcmp (file, "../", 3))
+        file += 3;
+      stats[i] = c->stats;
+      snprintf (stats[i].name, sizeof stats[i].name, "%s (%s:%d)",
+                name, file, c->line);
+      i++;
+    }
+  intr_set_level (old_level);
+
+  return i;
+}
+
+/* Prints lock contention statistics, most contended lock class
+   first. */
+void
+lockstat_print_stats (void) 
+{
+  struct lockstat *stats;
+  int cnt, i;
+
+  cnt = list_size (&lock_classes);
+  stats = malloc (cnt * sizeof *stats);
+  if (stats == NULL)
+    return;
+  cnt = lockstat_get (stats, cnt);
+
+  printf ("Lockstat: %10s %10s %14s %12s %14s %12s  %s\n",
+          "acquired", "contended", "wait cycles", "max wait",
+          "hold cycles", "max hold", "lock");
+  for (i = 0; i < cnt; i++) 
+    {
+      const struct lockstat *s = &stats[i];
+      printf ("Lockstat: %10"PRIu32" %10"PRIu32" %14"PRIu64" %12"PRIu64
+              " %14"PRIu64" %12"PRIu64"  %s\n",
+              s->acquired, s->contended, s->wait_cycles,
+              s->max_wait_cycles, s->hold_cycles, s->max_hold_cycles,
+              s->name);
+    }
+  free (stats);
+}
+#endif
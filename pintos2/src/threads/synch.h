@@ -2,7 +2,9 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <lockstat.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* A counting semaphore. */
 struct semaphore 
@@ -22,9 +24,53 @@ struct lock
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+#ifdef LOCKSTAT
+    struct lock_class *class;   /* Where contention is accounted. */
+    uint64_t acquire_time;      /* When holder acquired it, in cycles. */
+#endif
   };
 
+#ifdef LOCKSTAT
+/* Lock contention statistics, enabled by building the kernel
+   with "make LOCKSTAT=1".
+
+   All of the locks initialized by the same lock_init() call
+   share a lock class, which lock_init() declares as a static
+   variable at the call site, so that locks that come and go,
+   such as those in malloc()'d structures, are accounted for
+   together and never leave a dangling entry behind.  Each class
+   is named after the lock_init() argument and the file and line
+   of the call.
+
+   Only locks are instrumented, not semaphores.  A semaphore has
+   no owner, so it has no hold time, and waiting on one is usually
+   the point, as in process_wait() or waiting for a disk request
+   to finish, so not being able to down it at once is not
+   contention. */
+struct lock_class 
+  {
+    struct list_elem elem;      /* Element in list of all classes. */
+    const char *name;           /* lock_init() argument. */
+    const char *file;           /* Source file of lock_init() call. */
+    int line;                   /* Source line of lock_init() call. */
+    struct lockstat stats;      /* Statistics, except for the name. */
+  };
+
+#define lock_init(LOCK)                                                 \
+        do                                                              \
+          {                                                             \
+            static struct lock_class lock_class_ =                      \
+              { .name = #LOCK, .file = __FILE__, .line = __LINE__ };    \
+            lock_init_class (LOCK, &lock_class_);                       \
+          }                                                             \
+        while (0)
+void lock_init_class (struct lock *, struct lock_class *);
+
+int lockstat_get (struct lockstat *, int cnt);
+void lockstat_print_stats (void);
+#else
 void lock_init (struct lock *);
+#endif
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
@@ -30,6 +30,20 @@ static struct list ready_list;
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
+/* Table of all live threads by tid, for get_thread_by_tid().
+   Tids are handed out in sequence, so taking the tid modulo the
+   number of buckets spreads threads evenly, and a lookup only
+   scans the few threads that share a bucket.  The table is made
+   of links embedded in the threads, so it needs no memory
+   allocation and works before malloc_init().  Accessed with
+   interrupts off. */
+#define TID_BUCKET_CNT 128
+static struct list tid_buckets[TID_BUCKET_CNT];
+
+/* Next tid to hand out.  Tids are never reused, so a stale tid
+   can never find a newer thread in the table. */
+static tid_t next_tid = 1;
+
 /* Idle thread. */
 static struct thread *idle_thread;
 
@@ -70,8 +84,11 @@ static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
+static void yield (bool preempted);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static struct list *tid_bucket (tid_t);
+static void tid_table_insert (struct thread *);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -89,17 +106,22 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
   list_init (&ready_list);
   list_init (&all_list);
+  for (i = 0; i < TID_BUCKET_CNT; i++)
+    list_init (&tid_buckets[i]);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid ();
+  tid_table_insert (initial_thread);
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -119,22 +141,28 @@ thread_start (void)
   sema_down (&idle_started);
 }
 
-/* Called by the timer interrupt handler at each timer tick.
-   Thus, this function runs in an external interrupt context. */
+/* Called by the timer interrupt handler at each timer tick,
+   with the frame of the code that the tick interrupted.  Thus,
+   this function runs in an external interrupt context. */
 void
-thread_tick (void) 
+thread_tick (const struct intr_frame *f) 
 {
   struct thread *t = thread_current ();
 
-  /* Update statistics. */
+  /* Update statistics.  The tick belongs to user mode if it
+     interrupted code running at ring 3. */
   if (t == idle_thread)
     idle_ticks++;
-#ifdef USERPROG
-  else if (t->pagedir != NULL)
-    user_ticks++;
-#endif
+  else if ((f->cs & 3) == 3)
+    {
+      user_ticks++;
+      t->rusage.user_ticks++;
+    }
   else
-    kernel_ticks++;
+    {
+      kernel_ticks++;
+      t->rusage.kernel_ticks++;
+    }
 
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
@@ -185,6 +213,7 @@ thread_create (const char *name, int priority,
   /* Initialize thread. */
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
+  tid_table_insert (t);
 
   /* Prepare thread for first run by initializing its stack.
      Do this atomically so intermediate values for the 'stack' 
@@ -223,10 +252,14 @@ thread_create (const char *name, int priority,
 void
 thread_block (void) 
 {
+  struct thread *cur = thread_current ();
+
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
 
-  thread_current ()->status = THREAD_BLOCKED;
+  if (cur != idle_thread)
+    cur->rusage.vol_switches++;
+  cur->status = THREAD_BLOCKED;
   schedule ();
 }
 
@@ -293,7 +326,6 @@ thread_exit (void)
   ASSERT (!intr_context ());
 
   struct thread *ct = thread_current();
-  frame_delete_by_pid(ct->tid);
   //swap_entry_delete_by_tid(ct->tid);
 
 
@@ -309,6 +341,8 @@ thread_exit (void)
     //printf("exit: (%s) %p, %d\n", ct->name, child_struct, ct->exit_status);
     child_struct->status = THREAD_DYING;
     child_struct->exit_status = ct->exit_status;
+    child_struct->rusage = ct->rusage;
+    rusage_add (&child_struct->rusage, &ct->child_rusage);
   }
 
   while(list_size(&ct->child_thread_list) != 0)
@@ -339,6 +373,7 @@ thread_exit (void)
 
   intr_disable ();
   list_remove (&ct->allelem);
+  list_remove (&ct->tidelem);
   sema_up(&ct->waiting_sema);
   ct->status = THREAD_DYING;
   schedule ();
@@ -349,6 +384,22 @@ thread_exit (void)
    may be scheduled again immediately at the scheduler's whim. */
 void
 thread_yield (void) 
+{
+  yield (false);
+}
+
+/* Yields the CPU because the current thread's time slice is up.
+   Like thread_yield(), but counted as an involuntary context
+   switch. */
+void
+thread_preempt (void) 
+{
+  yield (true);
+}
+
+/* Does the work of thread_yield() and thread_preempt(). */
+static void
+yield (bool preempted) 
 {
   struct thread *cur = thread_current ();
   enum intr_level old_level;
@@ -357,7 +408,13 @@ thread_yield (void)
 
   old_level = intr_disable ();
   if (cur != idle_thread) 
-    list_push_back (&ready_list, &cur->elem);
+    {
+      if (preempted)
+        cur->rusage.invol_switches++;
+      else
+        cur->rusage.vol_switches++;
+      list_push_back (&ready_list, &cur->elem);
+    }
   cur->status = THREAD_READY;
   schedule ();
   intr_set_level (old_level);
@@ -517,6 +574,9 @@ init_thread (struct thread *t, const char *name, int priority)
   t->file_lock_hold = 0;
   t->is_running = false;
   sema_init(&t->waiting_sema, 0);
+#ifdef VM
+  list_init (&t->frames);
+#endif
   list_push_back (&all_list, &t->allelem);
 }
 
@@ -620,7 +680,6 @@ schedule (void)
 static tid_t
 allocate_tid (void) 
 {
-  static tid_t next_tid = 1;
   tid_t tid;
 
   lock_acquire (&tid_lock);
@@ -635,22 +694,46 @@ allocate_tid (void)
 uint32_t thread_stack_ofs = offsetof (struct thread, stack);
 
 
+/* Returns the bucket in the tid table for TID. */
+static struct list *
+tid_bucket (tid_t tid)
+{
+  return &tid_buckets[(unsigned) tid % TID_BUCKET_CNT];
+}
+
+/* Adds T, which has just been given its tid, to the tid table. */
+static void
+tid_table_insert (struct thread *t)
+{
+  enum intr_level old_level = intr_disable ();
+  list_push_back (tid_bucket (t->tid), &t->tidelem);
+  intr_set_level (old_level);
+}
+
 /* FUNCTION FOR PROJECT 2
-   Maps tid and thread, so that can find thread with tid. */
+   Maps tid and thread, so that can find thread with tid.
+   Returns a null pointer if no live thread has that tid. */
 
 struct thread * 
 get_thread_by_tid(tid_t tid)
 {
+  struct list *bucket = tid_bucket (tid);
+  struct thread *found = NULL;
   struct list_elem *e;
-  e = list_begin(&all_list);
+  enum intr_level old_level;
 
-  for(; e != list_end(&all_list); e = list_next(e))
-  {
-    struct thread *t = list_entry(e, struct thread, allelem);
-    if (t->tid == tid)
-      return t;
-  }
-  return NULL;
+  old_level = intr_disable ();
+  for (e = list_begin (bucket); e != list_end (bucket); e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, tidelem);
+      if (t->tid == tid)
+        {
+          found = t;
+          break;
+        }
+    }
+  intr_set_level (old_level);
+  return found;
 }
 
 struct list_elem *find_child_by_tid(struct list *child_list, tid_t tid)
@@ -667,4 +750,18 @@ struct list_elem *find_child_by_tid(struct list *child_list, tid_t tid)
   }
 
   return NULL;
-}
\ No newline at end of file
+}
+
+/* Adds the resource usage in B to A. */
+void
+rusage_add (struct rusage *a, const struct rusage *b) 
+{
+  a->user_ticks += b->user_ticks;
+  a->kernel_ticks += b->kernel_ticks;
+  a->vol_switches += b->vol_switches;
+  a->invol_switches += b->invol_switches;
+  a->page_faults += b->page_faults;
+  a->swap_ins += b->swap_ins;
+  a->bytes_read += b->bytes_read;
+  a->bytes_written += b->bytes_written;
+}
@@ -2,7 +2,9 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <hash.h>
 #include <list.h>
+#include <rusage.h>
 #include <stdint.h>
 #include "threads/synch.h"
 
@@ -90,6 +92,7 @@ struct thread
     uint8_t *stack;                     /* Saved stack pointer. */
     int priority;                       /* Priority. */
     struct list_elem allelem;           /* List element for all threads list. */
+    struct list_elem tidelem;           /* List element for tid table. */
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
@@ -109,10 +112,21 @@ struct thread
 
     bool is_running;
 
+    struct rusage rusage;               /* Resources used by this thread. */
+    struct rusage child_rusage;         /* Used by waited-for children. */
+
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
 #endif
+#ifdef VM
+    /* Owned by vm/pagetable.c. */
+    struct hash pages;                  /* Supplemental page table. */
+    struct file *exec_file;             /* Backs PAGE_FILE pages. */
+
+    /* Owned by vm/frame.c. */
+    struct list frames;                 /* Frames holding our pages. */
+#endif
 
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
@@ -124,6 +138,7 @@ struct child_thread
   struct thread *t;
   enum thread_status status;
   int exit_status;
+  struct rusage rusage;         /* Child's usage, including its children. */
   struct list_elem elem;
 };
 
@@ -137,7 +152,8 @@ extern bool thread_mlfqs;
 void thread_init (void);
 void thread_start (void);
 
-void thread_tick (void);
+struct intr_frame;
+void thread_tick (const struct intr_frame *);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
@@ -152,6 +168,7 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_preempt (void);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
@@ -167,4 +184,6 @@ int thread_get_load_avg (void);
 
 struct list_elem *find_child_by_tid(struct list *child_list, tid_t tid);
 
+void rusage_add (struct rusage *, const struct rusage *);
+
 #endif /* threads/thread.h */
@@ -20,8 +20,6 @@ static void kill (struct intr_frame *);
 bool _is_valid_addr(const void *addr);
 static void page_fault (struct intr_frame *);
 
-struct lock exception_lock;
-
 /* Registers handlers for interrupts that can be caused by user
    programs.
 
@@ -40,7 +38,6 @@ struct lock exception_lock;
 void
 exception_init (void) 
 {
-  lock_init(&exception_lock);
   /* These exceptions can be raised explicitly by a user program,
      e.g. via the INT, INT3, INTO, and BOUND instructions.  Thus,
      we set DPL==3, meaning that user programs are allowed to
@@ -154,6 +151,7 @@ page_fault (struct intr_frame *f)
 
   /* Count page faults. */
   page_fault_cnt++;
+  thread_current ()->rusage.page_faults++;
 
   printf("(%s, %d)    PAGE FAULT fault_addr = %p\n", thread_current()->name, thread_current()->tid, fault_addr);
 
@@ -176,49 +174,26 @@ page_fault (struct intr_frame *f)
 
   if (is_user_vaddr(fault_addr))
   {
-    lock_acquire(&exception_lock);
+    /* page_load() does its own locking, and reads the page in
+       without holding any lock, so faults need not wait for each
+       other here. */
     struct thread* t = thread_current();
     void *p = pagedir_get_page(t->pagedir, fault_addr);
     printf("(%s, %d)  PAGE FAULT: p = %p\n", t->name, t->tid, p);
     if (p != NULL)
     {
-      lock_release(&exception_lock);
       return;
     }
     else
     {
       void *fault_addr_ = (void *)((uint32_t)fault_addr & 0xfffff000);
       printf("(%s, %d)page fault: input addr = %p, (screened)%p, pd = %p\n", t->name, t->tid, fault_addr, fault_addr_, t->pagedir);
-      struct page_entry *p_e = page_entry_lookup(fault_addr_, t->tid);
-      printf("(%s, %d)lookup page entry %p, is_swapped = %d, upage %p, kpage %p\n", t->name, t->tid, p_e, is_swapped(p_e), page_entry_upage(p_e), page_entry_kpage(p_e));
-
-      if (p_e == NULL)
+      if (!page_load(t, fault_addr_))
       {
-        lock_release(&exception_lock);
         syscall_exit(-1);
       }
-
-      if(is_swapped(p_e))
-      {
-        void *pages = palloc_get_page(PAL_USER);
-        swap_disk_to_frame(pages, page_entry_kpage(p_e), t->tid);
-        flap_swapped_flag(p_e);
-        pagedir_set_page (t->pagedir, fault_addr_, pages, page_entry_writable(p_e));
-        void *dst = pagedir_get_page(t->pagedir, fault_addr);
-        printf("(%s, %d)set well? %p\n", t->name, t->tid, dst);
-        printf("(%s, %d)page fault : re-swap end, swap flag %d\n\n", t->name, t->tid, is_swapped(p_e));
-
-        page_entry_update_kpage(p_e, pages);
-        
-        lock_release(&exception_lock);
-        return;
-      }
-      else
-      {
-        lock_release(&exception_lock);
-        return page_entry_kpage(p_e);
-      }
-      lock_release(&exception_lock);
+      printf("(%s, %d)page fault : loaded %p\n\n", t->name, t->tid, fault_addr_);
+      return;
     }
   }
   else
@@ -122,11 +122,9 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
     {
       ASSERT ((*pte & PTE_P) == 0);
       *pte = pte_create_user (kpage, writable);
-      void *pe = page_entry_insert(upage, kpage, writable, thread_current()->tid);
 
-      frame_entry_insert(upage, kpage, thread_current()->tid);
+      frame_entry_insert(upage, kpage, thread_current());
 
-      //printf("(%s, %d)pagedir set page page entry = %p\n", thread_current()->name, thread_current()->tid, pe);
       //printf("\n");
       return true;
     }
@@ -17,6 +17,7 @@
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "vm/pagetable.h"
 
 static thread_func start_process NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
@@ -75,7 +76,7 @@ process_execute (const char *file_name)
 
   list_push_back(&cur->child_thread_list, &ct->elem);
 
-  sema_down(&get_thread_by_tid(tid)->waiting_sema);
+  sema_down(&new->waiting_sema);
 
   if (ct->status == THREAD_DYING)
   {
@@ -237,6 +238,7 @@ process_wait (tid_t child_tid UNUSED)
     if (ct->status == THREAD_DYING)
     {
       int ret = ct->exit_status;
+      rusage_add(&cur->child_rusage, &ct->rusage);
       list_remove(child_elem);
       free(ct);
       return ret;
@@ -260,6 +262,7 @@ process_wait (tid_t child_tid UNUSED)
 
     cur->waiting_child = NULL;
     int ret = ct->exit_status;
+    rusage_add(&cur->child_rusage, &ct->rusage);
     list_remove(waiting_child);
     free(ct);
     return ret;
@@ -277,8 +280,14 @@ process_exit (void)
   if (cur->file != NULL)
     file_allow_write(cur->file);
 
-  /* Destroy the current process's page directory and switch back
-     to the kernel-only page directory. */
+  /* Destroy the current process's supplemental page table, then
+     release its frames, which pagetable_destroy() does under the
+     same lock so that the evictor never finds a frame whose page
+     is gone, and only then the page directory, which frees the
+     pages in those frames.  Destroy the page directory and switch
+     back to the kernel-only page directory. */
+  pagetable_destroy (cur);
+
   pd = cur->pagedir;
   if (pd != NULL) 
     {
@@ -398,6 +407,8 @@ load (const char *file_name, void (**eip) (void), void **esp)
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL) 
     goto done;
+  if (!pagetable_create (t))
+    goto done;
 
   process_activate ();
 
@@ -415,6 +426,8 @@ load (const char *file_name, void (**eip) (void), void **esp)
       printf ("load: %s: open failed\n", file_name);
       goto done; 
     }
+  if (!pagetable_set_file (t, file))
+    goto done;
 
   /* Read and verify executable header. */
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
@@ -507,7 +520,8 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
 /* load() helpers. */
 
-static bool install_page (void *upage, void *kpage, bool writable);
+static bool install_page (void *upage, void *kpage, bool writable,
+                          off_t ofs, size_t read_bytes);
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -599,7 +613,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       memset (kpage + page_read_bytes, 0, page_zero_bytes);
 
       /* Add the page to the process's address space. */
-      if (!install_page (upage, kpage, writable)) 
+      if (!install_page (upage, kpage, writable, ofs, page_read_bytes)) 
         {
           palloc_free_page (kpage);
           return false; 
@@ -609,6 +623,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       read_bytes -= page_read_bytes;
       zero_bytes -= page_zero_bytes;
       upage += PGSIZE;
+      ofs += page_read_bytes;
     }
   return true;
 }
@@ -625,7 +640,8 @@ setup_stack (void **esp)
   kpage = palloc_get_page (PAL_USER | PAL_ZERO);
   if (kpage != NULL) 
     {
-      success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
+      success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true,
+                              0, 0);
       if (success)
         *esp = PHYS_BASE;
       else
@@ -641,15 +657,21 @@ setup_stack (void **esp)
    UPAGE must not already be mapped.
    KPAGE should probably be a page obtained from the user pool
    with palloc_get_page().
+   If READ_BYTES is nonzero, the page holds READ_BYTES bytes of
+   the executable starting at OFS, followed by zeros, and can be
+   read back from there; otherwise it is all zeros.
    Returns true on success, false if UPAGE is already mapped or
    if memory allocation fails. */
 static bool
-install_page (void *upage, void *kpage, bool writable)
+install_page (void *upage, void *kpage, bool writable,
+              off_t ofs, size_t read_bytes)
 {
   struct thread *t = thread_current ();
 
   /* Verify that there's not already a page at that virtual
      address, then map our page there. */
   return (pagedir_get_page (t->pagedir, upage) == NULL
+          && page_entry_insert (t, upage, kpage, writable, ofs,
+                                read_bytes) != NULL
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
@@ -13,10 +13,12 @@
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "devices/shutdown.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include "filesys/directory.h"
+#include "vm/pagetable.h"
 
 /* Process identifier. */
 typedef int pid_t;
@@ -36,6 +38,8 @@ int syscall_write (int fd, const void *buffer, unsigned length);
 void syscall_seek (int fd, unsigned position);
 unsigned syscall_tell (int fd);
 void syscall_close (int fd);
+int syscall_getrusage (int who, struct rusage *usage);
+int syscall_lockstat (struct lockstat *stats, int cnt);
 
 struct lock syscall_lock;
 
@@ -317,6 +321,22 @@ syscall_handler (struct intr_frame *f UNUSED)
   	  syscall_close(fd);
   	  break;
   	}
+  	case SYS_GETRUSAGE:
+  	{
+  	  catch_addr_error(f->esp + 8);
+  	  int who = *(int*)(f->esp + 4);
+  	  void *usage = *(void **)(f->esp + 8);
+  	  f->eax = syscall_getrusage(who, (struct rusage *)usage);
+  	  break;
+  	}
+  	case SYS_LOCKSTAT:
+  	{
+  	  catch_addr_error(f->esp + 8);
+  	  void *stats = *(void **)(f->esp + 4);
+  	  int cnt = *(int*)(f->esp + 8);
+  	  f->eax = syscall_lockstat((struct lockstat *)stats, cnt);
+  	  break;
+  	}
   	default:
   	  break;
   }
@@ -475,13 +495,16 @@ int syscall_filesize (int fd)
 int syscall_read (int fd, void *buffer, unsigned length)
 {
   //printf("SYSCALL READ(%s) : start\n", thread_current()->name);
-	catch_addr_error(buffer);
-	catch_addr_error(buffer + length - 1);
+	/* Keep the buffer in memory while we write into it. */
+	if (!page_pin_range(buffer, length))
+		syscall_exit(-1);
   if (fd == 0)
   {
     //printf("SYSCALL READ(%s) : console\n", thread_current()->name);
   	uint8_t keyboard_input = input_getc();
   	memcpy(buffer, &keyboard_input, sizeof(uint8_t));
+  	page_unpin_range(buffer, length);
+  	thread_current()->rusage.bytes_read += sizeof(uint8_t);
   	return sizeof(uint8_t);
   }
 
@@ -491,6 +514,7 @@ int syscall_read (int fd, void *buffer, unsigned length)
   if (file == NULL)
   {
     //printf("SYSCALL READ(%s) : fail\n", thread_current()->name);
+  	page_unpin_range(buffer, length);
   	return -1;
   }
 
@@ -498,14 +522,18 @@ int syscall_read (int fd, void *buffer, unsigned length)
   lock_acquire(&syscall_lock);
   int read_l = file_read(file, buffer, length);
   lock_release(&syscall_lock);
+  page_unpin_range(buffer, length);
+  if (read_l > 0)
+    thread_current()->rusage.bytes_read += read_l;
   //printf("readl = %d\n", read_l);
   //printf("SYSCALL READ(%s) : read finished\n", thread_current()->name);
   return read_l;
 }
 int syscall_write (int fd, const void *buffer, unsigned length)
 {
-	catch_addr_error(buffer);
-	catch_addr_error(buffer + length - 1);
+	/* Keep the buffer in memory while we read from it. */
+	if (!page_pin_range(buffer, length))
+		syscall_exit(-1);
   int ret;
   struct file *file;
 
@@ -529,6 +557,9 @@ int syscall_write (int fd, const void *buffer, unsigned length)
 
   }
   lock_release(&syscall_lock);
+  page_unpin_range(buffer, length);
+  if (ret > 0)
+    thread_current()->rusage.bytes_written += ret;
 
   //printf("write file done = %d %d, to %p\n", fd, ret, file);
   return ret;
@@ -557,6 +588,60 @@ void syscall_close (int fd)
   ffn->file_state = FILE_CLOSED;
 }
 
+/* Copies the resource usage of the calling process, if WHO is
+   RUSAGE_SELF, or the total usage of all the children it has
+   waited for and their waited-for descendants, if WHO is
+   RUSAGE_CHILDREN, into USAGE.  Returns 0 if successful, -1 if
+   WHO is invalid. */
+int syscall_getrusage (int who, struct rusage *usage)
+{
+  struct thread *cur = thread_current();
+
+  catch_addr_error(usage);
+  catch_addr_error((uint8_t *)usage + sizeof *usage - 1);
+
+  if (who == RUSAGE_SELF)
+    *usage = cur->rusage;
+  else if (who == RUSAGE_CHILDREN)
+    *usage = cur->child_rusage;
+  else
+    return -1;
+  return 0;
+}
+
+/* Copies the contention statistics of up to CNT lock classes
+   into STATS, most contended first, and returns the number
+   copied.  At most one page's worth is copied.  Returns -1 if
+   CNT is negative or the kernel was built without LOCKSTAT. */
+int syscall_lockstat (struct lockstat *stats UNUSED, int cnt UNUSED)
+{
+#ifdef LOCKSTAT
+  struct lockstat *kstats;
+  uint8_t *p;
+
+  if (cnt < 0)
+    return -1;
+  if ((size_t) cnt > PGSIZE / sizeof *kstats)
+    cnt = PGSIZE / sizeof *kstats;
+  if (cnt == 0)
+    return 0;
+
+  for (p = pg_round_down(stats); p < (uint8_t *)(stats + cnt); p += PGSIZE)
+    catch_addr_error(p < (uint8_t *)stats ? (void *)stats : p);
+  catch_addr_error((uint8_t *)(stats + cnt) - 1);
+
+  kstats = palloc_get_page(0);
+  if (kstats == NULL)
+    return -1;
+  cnt = lockstat_get(kstats, cnt);
+  memcpy(stats, kstats, cnt * sizeof *kstats);
+  palloc_free_page(kstats);
+  return cnt;
+#else
+  return -1;
+#endif
+}
+
 bool check_syscall_lock()
 {
   if (syscall_lock.semaphore.value == 0)
@@ -1,23 +1,51 @@
+#include <debug.h>
 #include <stdbool.h>
 #include "frame.h"
 #include "lib/kernel/list.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
 
 struct frame_entry
 {
-  struct list_elem list_elem;
+  struct list_elem list_elem;   /* Element in the owner's frames list. */
   void *upage;
-  void *kpage;
-  tid_t owner_pid;
+  struct thread *owner;         /* Null if the frame is not in use. */
+  bool pinned;                  /* Never chosen for eviction. */
 };
 
-struct list frametable;
+/* One entry per page in the user pool, allocated at boot.  The
+   entry for the frame at kernel address KPAGE is
+   frametable[(KPAGE - frame_base) / PGSIZE].
+
+   find_swap_victim() sweeps a "clock hand" around the array,
+   treating it as a circle.  Every frame in use is also on its
+   owner's `frames' list, so that a process can release its own
+   frames without looking at anybody else's. */
+static struct frame_entry *frametable;
+static uint8_t *frame_base;
+static size_t frame_cnt;
+static size_t clock_hand;
+static struct lock frame_lock;
+
+static struct frame_entry *frame_entry_at(const void *kpage);
+static struct frame_entry *clock_advance(void);
+static void frame_entry_remove(struct frame_entry *f);
 
 
 void
 frametable_init(void)
 {
-  list_init(&frametable);
+  frame_base = palloc_user_base();
+  frame_cnt = palloc_user_page_cnt();
+  frametable = calloc(frame_cnt, sizeof *frametable);
+  if (frametable == NULL)
+    PANIC("frame: cannot allocate frame table for %zu frames", frame_cnt);
+  lock_init(&frame_lock);
+  clock_hand = 0;
 }
 
 
@@ -27,77 +55,174 @@ void *frame_entry_upage(struct frame_entry *f)
 }
 void *frame_entry_kpage(struct frame_entry *f)
 {
-  return f->kpage;
+  return frame_base + (f - frametable) * PGSIZE;
 }
-void *frame_entry_owner_pid(struct frame_entry *f)
+struct thread *frame_entry_owner(struct frame_entry *f)
 {
-  return f->owner_pid;
+  return f->owner;
 }
 
-struct frame_entry *
-frame_entry_insert(const void *upage, const void *kpage, const tid_t owner_pid)
+/* Returns the entry for the user pool frame at KPAGE, or a null
+   pointer if KPAGE is not in the user pool. */
+static struct frame_entry *
+frame_entry_at(const void *kpage)
 {
-  struct frame_entry *new_frame_entry = (struct frame_entry *)malloc(sizeof(struct frame_entry));
+  const uint8_t *k = kpage;
 
-  new_frame_entry->upage = upage;
-  new_frame_entry->kpage = kpage;
-  new_frame_entry->owner_pid = owner_pid;
-
-  list_push_back(&frametable, &new_frame_entry->list_elem);
+  if (k < frame_base || k >= frame_base + frame_cnt * PGSIZE)
+    return NULL;
+  return &frametable[(k - frame_base) / PGSIZE];
+}
 
-  return new_frame_entry;
+struct frame_entry *
+frame_entry_insert(const void *upage, const void *kpage, struct thread *owner)
+{
+  struct frame_entry *f = frame_entry_at(kpage);
+
+  if (f == NULL)
+    return NULL;
+
+  lock_acquire(&frame_lock);
+  /* A frame that was freed without being deleted still sits on
+     its old owner's list. */
+  if (f->owner != NULL)
+    frame_entry_remove(f);
+  f->upage = (void *) upage;
+  f->owner = owner;
+  f->pinned = false;
+  list_push_back(&owner->frames, &f->list_elem);
+  lock_release(&frame_lock);
+
+  return f;
 }
 
 struct frame_entry *
 frame_entry_lookup(const void *kpage, const tid_t owner_pid)
 {
-  struct list_elem *e;
-  e = list_begin(&frametable);
+  struct frame_entry *f = frame_entry_at(kpage);
+  struct frame_entry *found = NULL;
 
-  for (; e != list_end(&frametable); e = list_next(e))
-  {
-    struct frame_entry *f = list_entry(e, struct frame_entry, list_elem);
+  if (f == NULL)
+    return NULL;
 
-    if (f->owner_pid == owner_pid && f->kpage == kpage)
-      return f;
-  }
+  lock_acquire(&frame_lock);
+  if (f->owner != NULL && f->owner->tid == owner_pid)
+    found = f;
+  lock_release(&frame_lock);
 
-  return NULL;
+  return found;
 }
 
+/* Pins F, so that it is never evicted, if PINNED is true, or
+   unpins it otherwise. */
 void
-frame_entry_delete(struct frame_entry *f)
+frame_entry_set_pinned(struct frame_entry *f, bool pinned)
 {
-  list_remove(&f->list_elem);
-  free(f);
+  lock_acquire(&frame_lock);
+  f->pinned = pinned;
+  lock_release(&frame_lock);
 }
 
 void
-frame_delete_by_pid(const tid_t tid)
+frame_entry_delete(struct frame_entry *f)
 {
-  struct thread *t = get_thread_by_tid(tid);
-  struct list_elem *e = list_begin(&frametable);
-  struct list_elem *list_end_elem = list_end(&frametable);
+  lock_acquire(&frame_lock);
+  if (f->owner != NULL)
+    frame_entry_remove(f);
+  lock_release(&frame_lock);
+}
 
-  while(e != list_end_elem)
+/* Releases every frame owned by T. */
+void
+frame_delete_by_owner(struct thread *t)
+{
+  lock_acquire(&frame_lock);
+  while (!list_empty(&t->frames))
   {
-    struct frame_entry *f = list_entry(e, struct frame_entry, list_elem);
-    struct list_elem *s = list_next(e);
-
-    if (f->owner_pid == tid)
-    {
-      list_remove(e);
-      free(f);
-    }
-    e = s;
+    struct frame_entry *f = list_entry(list_front(&t->frames),
+                                       struct frame_entry, list_elem);
+    frame_entry_remove(f);
   }
+  lock_release(&frame_lock);
+}
 
-  return;
+/* Marks F as no longer in use and takes it off its owner's
+   list.  The caller must hold frame_lock. */
+static void
+frame_entry_remove(struct frame_entry *f)
+{
+  list_remove(&f->list_elem);
+  f->owner = NULL;
+  f->upage = NULL;
+  f->pinned = false;
 }
 
-struct frame_entry *
-find_swap_victim()
+/* Returns the frame under the clock hand and moves the hand on
+   to the next one, wrapping around at the end of the table.  The
+   caller must hold frame_lock. */
+static struct frame_entry *
+clock_advance(void)
 {
-  return list_entry(list_pop_front(&frametable), struct frame_entry, list_elem);
+  struct frame_entry *f = &frametable[clock_hand];
+
+  if (++clock_hand == frame_cnt)
+    clock_hand = 0;
+  return f;
 }
 
+/* Chooses a frame to evict with the clock ("second chance")
+   algorithm, preferring clean pages, and returns it.  The frame
+   stays in the table, pinned, so that no other eviction chooses
+   it while it is written out, until it is deleted.
+
+   The hand sweeps around the frame table, skipping free and
+   pinned frames and giving every page that has been accessed
+   since the hand last passed it a second chance by clearing its
+   accessed bit.  The first page found that is neither accessed
+   nor dirty is the victim.  If the first revolution finds none
+   but has seen a page that was not accessed but dirty, the first
+   such page is the victim.  Otherwise the hand goes around once
+   more, when every accessed bit has been cleared, looking for a
+   clean page and then for a dirty one in the same way.  If there
+   is still none, every frame is free or pinned, and the kernel
+   panics. */
+struct frame_entry *
+find_swap_victim(void)
+{
+  struct frame_entry *victim = NULL;
+  struct frame_entry *dirty = NULL;
+  size_t i;
+
+  lock_acquire(&frame_lock);
+  for (i = 0; i < 2 * frame_cnt; i++)
+  {
+    struct frame_entry *f;
+    struct thread *owner;
+
+    if (i == frame_cnt && dirty != NULL)
+      break;
+
+    f = clock_advance();
+    owner = f->owner;
+    if (owner == NULL || f->pinned || owner->pagedir == NULL)
+      continue;
+
+    if (pagedir_is_accessed(owner->pagedir, f->upage))
+      pagedir_set_accessed(owner->pagedir, f->upage, false);
+    else if (!pagedir_is_dirty(owner->pagedir, f->upage))
+    {
+      victim = f;
+      break;
+    }
+    else if (dirty == NULL)
+      dirty = f;
+  }
+
+  if (victim == NULL)
+    victim = dirty;
+  if (victim == NULL)
+    PANIC("frame: no frame can be evicted");
+  victim->pinned = true;
+  lock_release(&frame_lock);
+  return victim;
+}
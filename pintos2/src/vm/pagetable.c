@@ -1,7 +1,10 @@
 #include <stdbool.h>
-#include "lib/kernel/list.h"
+#include <hash.h>
+#include <string.h>
 #include "pagetable.h"
+#include "filesys/file.h"
 #include "threads/thread.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 #include "userprog/pagedir.h"
@@ -9,36 +12,142 @@
 #include "vm/swap.h"
 #include "threads/synch.h"
 
-struct page_entry_list
-{
-  struct list_elem list_elem;
-  struct list entry_list;
-  tid_t owner_pid;
-};
-
+/* Supplemental page table entry: what the kernel knows about one
+   page of a process's address space beyond what the hardware
+   page table holds.  Each process keeps its entries in a hash
+   table in struct thread, keyed by user page, so that the page
+   fault handler and the evictor find a page in constant time.
+
+   A page that is not resident is brought back from where its
+   type says: a PAGE_ZERO page is zero-filled, a PAGE_FILE page is
+   read back from the process's executable, and a PAGE_SWAP page
+   from its swap slot.  Evicting a page only writes it to swap if
+   it is dirty; otherwise its backing store still holds what it
+   holds.  A page written to swap is a PAGE_SWAP page from then
+   on, and keeps its slot, which is written over whenever the
+   page is evicted dirty, until the process exits.
+
+   Pages are read in and written out without holding page_lock.
+   Meanwhile the page is "busy", and anybody else who wants it
+   waits on page_cond. */
 struct page_entry
 {
-  struct list_elem list_elem;
-  void *upage;
-  void *kpage;
-  bool writable;
-  bool is_swapped;
-  tid_t owner_pid;
+  struct hash_elem hash_elem;   /* Element in thread's pages table. */
+  void *upage;                  /* User virtual page. */
+  void *kpage;                  /* Frame, if resident. */
+  bool writable;                /* May the process write to it? */
+  bool resident;                /* In a frame? */
+  bool busy;                    /* Being read in or written out? */
+  enum page_type type;          /* Backing store. */
+  off_t file_ofs;               /* PAGE_FILE: offset in exec_file. */
+  size_t read_bytes;            /* PAGE_FILE: bytes to read, rest zero. */
+  size_t swap_slot;             /* PAGE_SWAP: slot. */
 };
 
-struct list pagetable;
 struct lock page_lock;
 
-struct page_entry_list *page_entry_list_lookup(tid_t tid);
+/* Signaled, with page_lock, when a page stops being busy. */
+static struct condition page_cond;
+
+static hash_hash_func page_entry_hash;
+static hash_less_func page_entry_less;
+static hash_action_func page_entry_destroy;
+static bool pagetable_busy(struct thread *t);
 
 void
 pagetable_init(void)
 {
   lock_init(&page_lock);
-  list_init(&pagetable);
-  #define _PAGE_TABLE_VALID_
+  cond_init(&page_cond);
 }
 
+/* Initializes T's supplemental page table.  Returns false if
+   memory is not available. */
+bool
+pagetable_create(struct thread *t)
+{
+  t->exec_file = NULL;
+  return hash_init(&t->pages, page_entry_hash, page_entry_less, NULL);
+}
+
+/* Makes FILE, the executable that T is being loaded from, the
+   backing store of T's PAGE_FILE pages.  T keeps a handle of its
+   own on FILE until pagetable_destroy().  Returns false if memory
+   is not available. */
+bool
+pagetable_set_file(struct thread *t, struct file *file)
+{
+  t->exec_file = file_reopen(file);
+  return t->exec_file != NULL;
+}
+
+/* Frees T's supplemental page table and every entry in it,
+   including the swap slots of pages that are swapped out, then
+   releases T's frames and closes T's executable.  Does nothing if
+   T has no table.  The frames must go while page_lock is still
+   held, because the evictor looks up the page in each frame it
+   chooses, and T's pages no longer exist.  Waits for pages that
+   are being written out to finish first. */
+void
+pagetable_destroy(struct thread *t)
+{
+  if (t->pages.buckets == NULL)
+    return;
+
+  lock_acquire(&page_lock);
+  while (pagetable_busy(t))
+    cond_wait(&page_cond, &page_lock);
+  hash_destroy(&t->pages, page_entry_destroy);
+  t->pages.buckets = NULL;
+  frame_delete_by_owner(t);
+  lock_release(&page_lock);
+
+  file_close(t->exec_file);
+  t->exec_file = NULL;
+}
+
+/* Returns true if any of T's pages is busy.  The caller must hold
+   page_lock. */
+static bool
+pagetable_busy(struct thread *t)
+{
+  struct hash_iterator i;
+
+  hash_first(&i, &t->pages);
+  while (hash_next(&i))
+    if (hash_entry(hash_cur(&i), struct page_entry, hash_elem)->busy)
+      return true;
+  return false;
+}
+
+/* Returns a hash of page entry E's user page. */
+static unsigned
+page_entry_hash(const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct page_entry *p = hash_entry(e, struct page_entry, hash_elem);
+  return hash_bytes(&p->upage, sizeof p->upage);
+}
+
+/* Returns true if page entry A's user page precedes B's. */
+static bool
+page_entry_less(const struct hash_elem *a_, const struct hash_elem *b_,
+                void *aux UNUSED)
+{
+  const struct page_entry *a = hash_entry(a_, struct page_entry, hash_elem);
+  const struct page_entry *b = hash_entry(b_, struct page_entry, hash_elem);
+  return a->upage < b->upage;
+}
+
+/* Frees page entry E, and its swap slot if it has one. */
+static void
+page_entry_destroy(struct hash_elem *e, void *aux UNUSED)
+{
+  struct page_entry *p = hash_entry(e, struct page_entry, hash_elem);
+
+  if (p->type == PAGE_SWAP)
+    swap_slot_free(p->swap_slot);
+  free(p);
+}
 
 void *page_entry_upage(struct page_entry *p)
 {
@@ -55,140 +164,248 @@ bool page_entry_writable(struct page_entry *p)
   return p->writable;
 }
 
-void page_entry_update_kpage(struct page_entry *p, void *new_kpage)
-{
-  p->kpage = new_kpage;
-}
-
-struct page_entry_list *
-page_entry_list_lookup(tid_t owner_pid)
+/* Returns the entry for UPAGE in T's supplemental page table, or
+   a null pointer if there is none.  The caller must hold
+   page_lock, unless T is the running thread and only reads the
+   entry's fixed fields. */
+struct page_entry *
+page_entry_lookup(struct thread *t, const void *upage)
 {
-  struct list_elem *e;
-  e = list_begin(&pagetable);
-
-  for (; e != list_end(&pagetable); e = list_next(e))
-  {
-    struct page_entry_list *pe = list_entry(e, struct page_entry_list, list_elem);
+  struct page_entry key;
+  struct hash_elem *e;
 
-    if(pe->owner_pid == owner_pid)
-      return pe;
-  }
-
-  return NULL;
+  key.upage = (void *) upage;
+  e = hash_find(&t->pages, &key.hash_elem);
+  return e != NULL ? hash_entry(e, struct page_entry, hash_elem) : NULL;
 }
 
+/* Adds an entry for UPAGE, currently in frame KPAGE, to T's
+   supplemental page table.  If READ_BYTES is nonzero, the page
+   holds READ_BYTES bytes of T's executable starting at FILE_OFS,
+   followed by zeros; otherwise it is all zeros.  Returns the new
+   entry, or the existing one if UPAGE already has one, or a null
+   pointer if memory is not available. */
 struct page_entry *
-page_entry_lookup(const void *upage, tid_t owner_pid)
+page_entry_insert(struct thread *t, const void *upage, const void *kpage,
+                  bool writable, off_t file_ofs, size_t read_bytes)
 {
-  struct page_entry_list *pel = page_entry_list_lookup(owner_pid);
+  struct page_entry *p = malloc(sizeof *p);
+  struct hash_elem *old;
 
-  if (pel == NULL)
+  if (p == NULL)
     return NULL;
 
-  struct list_elem *e;
-  e = list_begin(&pel->entry_list);
+  p->upage = (void *) upage;
+  p->kpage = (void *) kpage;
+  p->writable = writable;
+  p->resident = true;
+  p->busy = false;
+  p->type = read_bytes > 0 ? PAGE_FILE : PAGE_ZERO;
+  p->file_ofs = file_ofs;
+  p->read_bytes = read_bytes;
 
-  for (; e != list_end(&pel->entry_list); e = list_next(e))
+  lock_acquire(&page_lock);
+  old = hash_insert(&t->pages, &p->hash_elem);
+  lock_release(&page_lock);
+  if (old != NULL)
   {
-    struct page_entry *pe = list_entry(e, struct page_entry, list_elem);
-
-    if(pe->upage == upage)
-      return pe;
+    free(p);
+    return hash_entry(old, struct page_entry, hash_elem);
   }
-
-  return NULL;
+  return p;
 }
 
-struct page_entry *
-page_entry_insert(const void *upage, const void *kpage, const bool writable, tid_t owner_pid)
+/* Brings T's page UPAGE back into a frame from its backing store
+   and maps it, unless it is resident already.  T must be the
+   running thread.  Returns false if T has no page at UPAGE or if
+   it cannot be read back. */
+bool
+page_load(struct thread *t, const void *upage)
 {
-  if (page_entry_lookup(upage, owner_pid) != NULL)
-    return;
+  struct page_entry *p;
+  void *kpage;
+  bool success = true;
 
-  struct page_entry_list *pel = page_entry_list_lookup(owner_pid);
+  ASSERT(t == thread_current());
 
-  if (pel == NULL)
+  lock_acquire(&page_lock);
+  p = page_entry_lookup(t, upage);
+  while (p != NULL && p->busy)
+    cond_wait(&page_cond, &page_lock);
+  if (p == NULL || p->resident)
   {
-    struct page_entry_list *new_pel = (struct page_entry_list *)malloc(sizeof(struct page_entry_list));
-    new_pel->owner_pid = owner_pid;
-    list_init(&new_pel->entry_list);
-    list_push_back(&pagetable, &new_pel->list_elem);
-    pel = new_pel;
+    lock_release(&page_lock);
+    return p != NULL;
   }
+  p->busy = true;
+  lock_release(&page_lock);
 
-  struct page_entry *new_page_entry = (struct page_entry *)malloc(sizeof(struct page_entry));
-
-  new_page_entry->upage = upage;
-  new_page_entry->kpage = kpage;
-  new_page_entry->writable = writable;
-  new_page_entry->is_swapped = false;
-  new_page_entry->owner_pid = owner_pid;
+  /* Getting a frame may evict a page, which takes page_lock.  P
+     is not resident, so it cannot be the one evicted, and only T
+     itself adds or removes entries in its table.  The new frame
+     is not in the frame table until it is mapped, so it cannot be
+     evicted while we fill it. */
+  kpage = palloc_get_page(PAL_USER);
+  if (kpage == NULL)
+    success = false;
+  else switch (p->type)
+  {
+    case PAGE_ZERO:
+      memset(kpage, 0, PGSIZE);
+      break;
+
+    case PAGE_FILE:
+      success = (file_read_at(t->exec_file, kpage, p->read_bytes, p->file_ofs)
+                 == (off_t) p->read_bytes);
+      memset((uint8_t *) kpage + p->read_bytes, 0, PGSIZE - p->read_bytes);
+      break;
+
+    case PAGE_SWAP:
+      swap_disk_to_frame(p->swap_slot, kpage);
+      t->rusage.swap_ins++;
+      break;
+  }
 
-  list_push_back(&pel->entry_list, &new_page_entry->list_elem);
+  lock_acquire(&page_lock);
+  if (success)
+  {
+    /* UPAGE was mapped before, so its page table exists and
+       mapping it again needs no memory. */
+    p->kpage = kpage;
+    p->resident = true;
+    if (!pagedir_set_page(t->pagedir, p->upage, kpage, p->writable))
+      PANIC("page: cannot map %p", p->upage);
+  }
+  p->busy = false;
+  cond_broadcast(&page_cond, &page_lock);
+  lock_release(&page_lock);
 
-  return new_page_entry;
+  if (!success && kpage != NULL)
+    palloc_free_page(kpage);
+  return success;
 }
 
-struct list_elem *
-page_entry_delete(struct page_entry *p)
+/* Pins or unpins the frame holding the running thread's page
+   UPAGE, which must be resident.  Returns false if it is not. */
+static bool
+page_set_pinned(const void *upage, bool pinned)
 {
-  struct list_elem *h = list_remove(&p->list_elem);
-  return h;
+  struct thread *t = thread_current();
+  struct page_entry *p;
+  bool resident;
+
+  lock_acquire(&page_lock);
+  p = page_entry_lookup(t, upage);
+  resident = p != NULL && p->resident;
+  if (resident)
+    frame_entry_set_pinned(frame_entry_lookup(p->kpage, t->tid), pinned);
+  lock_release(&page_lock);
+  return resident;
 }
 
+/* Brings every page of the SIZE bytes at user address BUFFER into
+   a frame and pins it there, so that the kernel can read or write
+   the buffer without faulting, and without the evictor taking a
+   page away in the middle.  Returns false, with nothing pinned,
+   if any of the bytes is not in a page of the running process.
+   page_unpin_range() undoes it. */
 bool
-is_swapped(struct page_entry *p)
+page_pin_range(const void *buffer, size_t size)
 {
-  if (p == NULL)
+  struct thread *t = thread_current();
+  const uint8_t *start = pg_round_down(buffer);
+  const uint8_t *end = (const uint8_t *) buffer + size;
+  const uint8_t *upage;
+
+  if (size == 0)
+    return true;
+  if (end < start || !is_user_vaddr(end - 1))
     return false;
-  return p->is_swapped;
+
+  for (upage = start; upage < end; upage += PGSIZE)
+  {
+    /* The page can be evicted again between loading and
+       pinning it; if so, load it again. */
+    do
+    {
+      if (!page_load(t, upage))
+      {
+        page_unpin_range(start, upage - start);
+        return false;
+      }
+    }
+    while (!page_set_pinned(upage, true));
+  }
+  return true;
 }
 
-bool
-flap_swapped_flag(struct page_entry *p)
+/* Unpins the pages of the SIZE bytes at user address BUFFER,
+   which page_pin_range() pinned. */
+void
+page_unpin_range(const void *buffer, size_t size)
 {
-  p->is_swapped = !p->is_swapped;
-  return p->is_swapped;
+  const uint8_t *end = (const uint8_t *) buffer + size;
+  const uint8_t *upage;
+
+  for (upage = pg_round_down(buffer); upage < end; upage += PGSIZE)
+    page_set_pinned(upage, false);
 }
 
+/* Evicts a page chosen by find_swap_victim() and returns its
+   frame, zeroed, for reuse.  The page is written to swap only if
+   it is dirty, to the slot it already has, if any.  The write
+   happens without page_lock, with the page busy and the frame
+   pinned. */
 void *
 page_swap_to_disk(void)
 {
-  lock_acquire(&page_lock);
-  //printf("  PAGE SWAP DISK\n");
+  struct frame_entry *f_e;
+  struct page_entry *p_e;
+  struct thread *owner;
   void *new_page;
-  struct frame_entry *f_e = find_swap_victim();
-  struct page_entry *p_e = page_entry_lookup(frame_entry_upage(f_e), frame_entry_owner_pid(f_e));
-
-
-  //printf("prev-allocated page = %p, victim frame = %p\n", frame_entry_upage(f_e), frame_entry_kpage(f_e));
-  //printf("page_entry(%p), upage = %p, kpage = %p\n", p_e, p_e->upage, p_e->kpage);
+  bool dirty;
 
+  lock_acquire(&page_lock);
+  f_e = find_swap_victim();
   ASSERT(f_e != NULL);
+  owner = frame_entry_owner(f_e);
+  ASSERT(owner != NULL);
+  p_e = page_entry_lookup(owner, frame_entry_upage(f_e));
   ASSERT(p_e != NULL);
-  ASSERT(!is_swapped(p_e));
-  //ASSERT(frame_entry_kpage(f_e) == p_e->kpage);
-
-  //printf("validity : OK\n");
+  ASSERT(p_e->resident);
 
-  new_page = p_e->kpage;
+  new_page = frame_entry_kpage(f_e);
 
-  if(get_thread_by_tid(p_e->owner_pid) != NULL)
+  /* Unmap the page before looking at its dirty bit, which
+     pagedir_clear_page() keeps, so that the owner cannot dirty it
+     after we have looked. */
+  pagedir_clear_page(owner->pagedir, p_e->upage);
+  dirty = pagedir_is_dirty(owner->pagedir, p_e->upage);
+  p_e->resident = false;
+  if (dirty)
   {
-    pagedir_clear_page(get_thread_by_tid(p_e->owner_pid)->pagedir, p_e->upage);
+    size_t slot = p_e->swap_slot;
+    bool has_slot = p_e->type == PAGE_SWAP;
+
+    /* The owner cannot free P_E while it is busy, and its frame
+       stays pinned, so neither goes away while we write. */
+    p_e->busy = true;
+    lock_release(&page_lock);
+    if (has_slot)
+      swap_frame_to_slot(slot, new_page);
+    else
+      slot = swap_frame_to_disk(new_page);
+    lock_acquire(&page_lock);
+
+    p_e->swap_slot = slot;
+    p_e->type = PAGE_SWAP;
+    p_e->busy = false;
+    cond_broadcast(&page_cond, &page_lock);
   }
-
-  flap_swapped_flag(p_e);
-  swap_frame_to_disk(frame_entry_kpage(f_e), p_e->owner_pid);
   frame_entry_delete(f_e);
 
-
   memset(new_page, 0, PGSIZE);
 
-  ASSERT(new_page != NULL);
-
-  //printf("new allocated frame = %p\n", new_page);
-
   lock_release(&page_lock);
   return new_page;
-}
\ No newline at end of file
+}
@@ -2,20 +2,35 @@
 #define __S_PAGETABLE__
 
 #include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
 #include "threads/thread.h"
 
+/* Where a page's contents come from when it is not in a frame. */
+enum page_type
+{
+  PAGE_ZERO,                    /* Nowhere: the page is all zeros. */
+  PAGE_FILE,                    /* The executable. */
+  PAGE_SWAP                     /* A swap slot. */
+};
+
 struct page_entry;
+struct file;
 
 void pagetable_init(void);
+bool pagetable_create(struct thread *t);
+bool pagetable_set_file(struct thread *t, struct file *file);
+void pagetable_destroy(struct thread *t);
+
 void *page_entry_upage(struct page_entry *p);
 void *page_entry_kpage(struct page_entry *p);
 bool page_entry_writable(struct page_entry *p);
-void page_entry_update_kpage(struct page_entry *p, void *new_kpage);
 
-struct page_entry *page_entry_lookup(const void *upage, tid_t owner_pid);
-struct page_entry *page_entry_insert(const void *upage, const void *kpage, const bool writable, tid_t owner_id);
-bool is_swapped(struct page_entry *p);
-bool flap_swapped_flag(struct page_entry *p);
+struct page_entry *page_entry_lookup(struct thread *t, const void *upage);
+struct page_entry *page_entry_insert(struct thread *t, const void *upage, const void *kpage, bool writable, off_t file_ofs, size_t read_bytes);
+bool page_load(struct thread *t, const void *upage);
+bool page_pin_range(const void *buffer, size_t size);
+void page_unpin_range(const void *buffer, size_t size);
 
 void *page_swap_to_disk(void);
 
@@ -1,3 +1,5 @@
+#include <bitmap.h>
+#include <debug.h>
 #include <stdbool.h>
 #include "swap.h"
 #include "devices/block.h"
@@ -6,212 +8,142 @@
 #include "threads/pte.h"
 #include "threads/synch.h"
 
-struct swap_entry_list
-{
-  struct list_elem list_elem;
-  tid_t owner_pid;
-  struct list swap_list;
-};
-
-struct swap_entry
-{
-  struct list_elem list_elem;
-  void *kpage;
-  block_sector_t disk_offset;
-};
+/* Number of sectors in a swap slot, which holds one page. */
+#define SECTORS_PER_SLOT (PGSIZE / BLOCK_SECTOR_SIZE)
 
+/* Number of slots handed out together as a cluster.  Pages that
+   are evicted one after another go to consecutive slots, so they
+   sit next to each other on disk. */
+#define SWAP_CLUSTER 16
 
 struct block *swap_disk;
-struct list swap_table;
-block_sector_t swap_disk_size;
-bool *empty_block_sector;
-void *disk_buffer;
+
+/* Protects swap_slots and the cursor.  It is not held during disk
+   I/O: a slot being written or read belongs to the page that is
+   moving, so nobody else touches it until it is freed. */
 struct lock swap_lock;
 
+/* One bit per slot, true if the slot is in use. */
+static struct bitmap *swap_slots;
 
-struct swap_entry *swap_entry_lookup_sub(const void *kpage, struct list *l);
-struct swap_entry_list *swap_entry_list_lookup(const tid_t owner_id);
+/* Next-fit cursor: the next slot to hand out, and how many slots
+   of the current cluster are left starting there. */
+static size_t swap_cursor;
+static size_t cluster_left;
+
+static size_t swap_scan(size_t cnt);
+static size_t swap_slot_alloc(void);
 
 
 void
 swap_disk_init(void)
 {
-  list_init(&swap_table);
+  size_t slot_cnt = 0;
+
   lock_init(&swap_lock);
   swap_disk = block_get_role(BLOCK_SWAP);
-  swap_disk_size = block_size(swap_disk) / 8;
-
-  empty_block_sector = (bool *)malloc(swap_disk_size);
-  int i = 0;
-  for (; i < swap_disk_size; i++)
-    empty_block_sector[i] = true;
-
-  disk_buffer = malloc(BLOCK_SECTOR_SIZE);
+  if (swap_disk != NULL)
+    slot_cnt = block_size(swap_disk) / SECTORS_PER_SLOT;
+
+  swap_slots = bitmap_create(slot_cnt);
+  if (swap_slots == NULL)
+    PANIC("swap: cannot allocate bitmap for %zu slots", slot_cnt);
+  swap_cursor = 0;
+  cluster_left = 0;
 }
 
-block_sector_t
-swap_find_empty_sector()
+/* Returns the first run of CNT free slots at or after the cursor,
+   wrapping around to the start of swap if there is none, or
+   BITMAP_ERROR if there is none at all. */
+static size_t
+swap_scan(size_t cnt)
 {
-  int i;
-  for (i = 0; i < swap_disk_size; i++)
-    if (empty_block_sector[i] == true)
-    {
-      empty_block_sector[i] = false;
-      return (block_sector_t)i;
-    }
+  size_t slot = bitmap_scan(swap_slots, swap_cursor, cnt, false);
 
-  return swap_disk_size + 1;
+  if (slot == BITMAP_ERROR && swap_cursor != 0)
+    slot = bitmap_scan(swap_slots, 0, cnt, false);
+  return slot;
 }
 
-struct swap_entry *
-swap_entry_insert(const void *kpage, const tid_t owner_pid)
+/* Allocates a swap slot and returns its index.  Slots come from
+   the current cluster while it lasts; after that a new cluster of
+   SWAP_CLUSTER free slots is found at or after the cursor, and
+   only when swap is too fragmented for that does a single free
+   slot do.  The caller must hold swap_lock. */
+static size_t
+swap_slot_alloc(void)
 {
-  block_sector_t empty_sector = swap_find_empty_sector();
-
-  ASSERT(empty_sector < swap_disk_size);
-
-  struct swap_entry_list *sl = swap_entry_list_lookup(owner_pid);
+  size_t slot;
 
-  if (sl == NULL)
+  if (cluster_left == 0 || swap_cursor >= bitmap_size(swap_slots)
+      || bitmap_test(swap_slots, swap_cursor))
   {
-    struct swap_entry_list *new_swap_entry_list = (struct swap_entry_list *)malloc(sizeof(struct swap_entry_list));
-    new_swap_entry_list->owner_pid = owner_pid;
-    list_init(&new_swap_entry_list->swap_list);
-    list_push_back(&swap_table, &new_swap_entry_list->list_elem);
-
-    sl = new_swap_entry_list;
+    slot = swap_scan(SWAP_CLUSTER);
+    cluster_left = SWAP_CLUSTER;
+    if (slot == BITMAP_ERROR)
+    {
+      slot = swap_scan(1);
+      cluster_left = 1;
+    }
+    if (slot == BITMAP_ERROR)
+      PANIC("swap: out of swap slots");
+    swap_cursor = slot;
   }
 
-  struct swap_entry *new_swap_entry = (struct swap_entry *)malloc(sizeof(struct swap_entry));
-  new_swap_entry->kpage = kpage;
-  new_swap_entry->disk_offset = empty_sector;
-  list_push_back(&sl->swap_list, &new_swap_entry->list_elem);
-  
-  return new_swap_entry;
+  slot = swap_cursor++;
+  cluster_left--;
+  bitmap_mark(swap_slots, slot);
+  return slot;
 }
 
-
-void
-swap_frame_to_disk(const void *kpage, const tid_t owner_pid)
+/* Writes the page in frame KPAGE to a newly allocated swap slot
+   and returns the slot's index. */
+size_t
+swap_frame_to_disk(const void *kpage)
 {
-  lock_acquire(&swap_lock);
-  struct swap_entry *s = swap_entry_insert(kpage, owner_pid);
-  //printf("(%s, %d)  SWAP(f->d) : swap_entry %p, swap offset %d\n", thread_current()->name, thread_current()->tid, s, s->disk_offset);
-  //printf("(%s, %d)  SWAP(f->d) : from %p, to disk\n", thread_current()->name, thread_current()->tid, kpage);
-
-  if (kpage == 0xc029d000 && owner_pid == 4)
-  {
-    hex_dump((uint32_t)kpage, kpage, 16, true);
-    hex_dump((uint32_t)kpage+16, kpage+16, 16, true);
-    hex_dump((uint32_t)kpage+32, kpage+32, 16, true);
-    hex_dump((uint32_t)kpage+48, kpage+48, 16, true);
-  }
+  size_t slot;
 
-  int i;
-  for (i = 0; i < 8; i++)
-  {
-    memcpy(disk_buffer, kpage + (i * BLOCK_SECTOR_SIZE), BLOCK_SECTOR_SIZE);
-    block_write (swap_disk, (8 * s->disk_offset) + i, disk_buffer); 
-  }
+  lock_acquire(&swap_lock);
+  slot = swap_slot_alloc();
   lock_release(&swap_lock);
-  //printf("swap_end\n");
-}
 
+  swap_frame_to_slot(slot, kpage);
+  return slot;
+}
 
+/* Writes the page in frame KPAGE over the contents of swap slot
+   SLOT, which must be in use. */
 void
-swap_disk_to_frame(const void *dst, const void *kpage, const tid_t owner_pid)
+swap_frame_to_slot(size_t slot, const void *kpage)
 {
   lock_acquire(&swap_lock);
-  struct swap_entry *s = swap_entry_lookup(kpage, owner_pid);
-  //printf("(%s, %d)  SWAP(d->f) : swap_entry %p, swap offset %d\n", thread_current()->name, thread_current()->tid, s, s->disk_offset);
-  //printf("(%s, %d)  SWAP(d->f) : from disk, to %p\n", thread_current()->name, thread_current()->tid, dst);
-
-  if (s == NULL)
-    return;
-
-  int i;
-  for (i = 0; i < 8; i++)
-  {
-    block_read (swap_disk, (8 * s->disk_offset) + i, disk_buffer); 
-    memcpy(dst + (i * BLOCK_SECTOR_SIZE), disk_buffer, BLOCK_SECTOR_SIZE);
-  }
-
-  swap_entry_delete(s);
+  ASSERT(bitmap_test(swap_slots, slot));
   lock_release(&swap_lock);
-  //printf("swap_end\n");
-}
 
-
-struct swap_entry_list *
-swap_entry_list_lookup(const tid_t owner_id)
-{
-  struct list_elem *e;
-  e = list_begin(&swap_table);
-
-  for (; e != list_end(&swap_table); e = list_next(e))
-  {
-    struct swap_entry_list *se = list_entry(e, struct swap_entry_list, list_elem);
-
-    if (se->owner_pid == owner_id)
-      return se;
-  }
-
-  return NULL;
-}
-
-
-struct swap_entry *
-swap_entry_lookup_sub(const void *kpage, struct list *l)
-{
-  struct list_elem *e = list_begin(l);
-
-  for (; e != list_end(l); e = list_next(e))
-  {
-    struct swap_entry *s = list_entry(e, struct swap_entry, list_elem);
-
-    if (s->kpage == kpage)
-      return s;
-  }
-
-  return NULL;
-}
-
-struct swap_entry *
-swap_entry_lookup(const void *kpage, const tid_t owner_pid)
-{
-  struct swap_entry_list *sl = swap_entry_list_lookup(owner_pid);
-
-  return sl != NULL ? swap_entry_lookup_sub(kpage, &sl->swap_list) : NULL;
+  block_write_multiple(swap_disk, SECTORS_PER_SLOT * slot, SECTORS_PER_SLOT,
+                       kpage);
 }
 
+/* Reads the page in swap slot SLOT into frame DST.  The slot
+   stays in use, so that the page need not be written again if it
+   is evicted before it is modified; swap_slot_free() frees it. */
 void
-swap_entry_delete(struct swap_entry *s)
+swap_disk_to_frame(size_t slot, void *dst)
 {
-  empty_block_sector[s->disk_offset] = true;
-  list_remove(s);
-  free(s);
+  lock_acquire(&swap_lock);
+  ASSERT(bitmap_test(swap_slots, slot));
+  lock_release(&swap_lock);
+
+  block_read_multiple(swap_disk, SECTORS_PER_SLOT * slot, SECTORS_PER_SLOT,
+                      dst);
 }
 
+/* Frees swap slot SLOT. */
 void
-swap_entry_delete_by_tid(tid_t owner_pid)
+swap_slot_free(size_t slot)
 {
   lock_acquire(&swap_lock);
-  struct swap_entry_list *sl = swap_entry_list_lookup(owner_pid);
-
-  if (sl != NULL)
-  {
-    list_remove(&sl->list_elem);
-    struct list_elem *e = list_begin(&sl->swap_list);
-
-    while(e != list_end(sl))
-    {
-      list_remove(e);
-      free(list_entry(e, struct swap_entry, list_elem));
-    }
-
-    free(sl);
-  }
-
+  ASSERT(bitmap_test(swap_slots, slot));
+  bitmap_reset(swap_slots, slot);
   lock_release(&swap_lock);
-  return;
 }